@@ -1,9 +1,6 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-#define READ_END 0
-#define WRITE_END 1
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
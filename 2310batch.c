@@ -0,0 +1,260 @@
+#include "2310batch.h"
+
+/** Exits with the error code.
+ *
+ * @param errorCode The error code to exit with.
+ * @exit code 1 - Invalid args
+ * @exit code 2 - A game's deck can't be read or is invalid
+ * @exit code 3 - A game's path can't be read or is invalid
+ * @exit code 4 - A game has too few or too many players, or a player
+ * which is not A or B
+ */
+void batch_exit(BatchErrorCode errorCode) {
+    switch (errorCode) {
+        case INVALID_BATCH_ARGS:
+            fprintf(stderr, "Usage: 2310batch [lanes]");
+            break;
+        case INVALID_BATCH_DECK:
+            fprintf(stderr, "Error reading deck");
+            break;
+        case INVALID_BATCH_PATH:
+            fprintf(stderr, "Error reading path");
+            break;
+        case INVALID_BATCH_GAME:
+            fprintf(stderr, "Invalid game");
+            break;
+    }
+    fprintf(stderr, "\n");
+    fflush(stderr);
+    fflush(stdout);
+    exit(errorCode);
+}
+
+/** Returns the file loaded earlier under the given name.
+ *
+ * @param loaded The files loaded so far
+ * @param fileName The file name
+ * @return The file, or NULL if it has not been loaded
+ */
+Loaded *find_loaded(Loaded *loaded, char *fileName) {
+    for (; loaded != NULL; loaded = loaded->next) {
+        if (strcmp(loaded->fileName, fileName) == 0) {
+            return loaded;
+        }
+    }
+    return NULL;
+}
+
+/** Remembers a loaded file for later games.
+ *
+ * @param loaded The files loaded so far, added to
+ * @param fileName The file name
+ * @param contents The path line or deck cards, which are kept
+ * @param numCards The number of cards, for decks
+ * @return The file
+ */
+Loaded *add_loaded(Loaded **loaded, char *fileName, char *contents,
+        int numCards) {
+    Loaded *file = malloc(sizeof(Loaded));
+    file->fileName = strdup(fileName);
+    file->contents = contents;
+    file->numCards = numCards;
+    file->next = *loaded;
+    *loaded = file;
+    return file;
+}
+
+/** Gives a game its deck's cards, reading a deck file the first time it
+ *  is used. Generated decks are made for each game, as a sweep may use
+ *  any number of seeds.
+ *
+ * @param game The game
+ * @param decks The deck files loaded so far
+ * @param deckName The deck file or seed:... spec
+ */
+void batch_deck(BatchGame *game, Loaded **decks, char *deckName) {
+    Loaded *loaded = is_seed_spec(deckName) ? NULL :
+            find_loaded(*decks, deckName);
+    if (loaded == NULL) {
+        Deck *deck = load_deck(deckName);
+        if (deck == NULL) {
+            batch_exit(INVALID_BATCH_DECK);
+        }
+        int numCards = deck->count;
+        char *cards = take_cards(deck);
+        if (is_seed_spec(deckName)) {
+            game->cards = cards;
+            game->numCards = numCards;
+            game->ownsCards = true;
+            return;
+        }
+        loaded = add_loaded(decks, deckName, cards, numCards);
+    }
+    game->cards = loaded->contents;
+    game->numCards = loaded->numCards;
+    game->ownsCards = false;
+}
+
+/** Returns a new path for a game, loading the path file the first time.
+ *
+ * @param paths The path files loaded so far
+ * @param pathName The path file
+ * @param numPlayers The number of players in the game
+ * @return The path, exiting if it is invalid
+ */
+Path *batch_path(Loaded **paths, char *pathName, int numPlayers) {
+    Loaded *loaded = find_loaded(*paths, pathName);
+    if (loaded != NULL) {
+        return allocate_path(loaded->contents, numPlayers);
+    }
+
+    char *givenPath;
+    Path *path = load_path(pathName, numPlayers, &givenPath);
+    if (path == NULL) {
+        batch_exit(INVALID_BATCH_PATH);
+    }
+    add_loaded(paths, pathName, strdup(givenPath), 0);
+    return path;
+}
+
+/** Returns true if the player program given plays as Player B, exiting
+ *  if it is neither A nor B.
+ *
+ * @param program A or B, or the name of the 2310A or 2310B program
+ * @return true for Player B
+ */
+bool plays_b(char *program) {
+    char playerType = program_player_type(program);
+    if (playerType == 0) {
+        batch_exit(INVALID_BATCH_GAME);
+    }
+    return playerType == 'B';
+}
+
+/** Sets up a game from a line of input, which has the dealer's arguments.
+ *
+ * @param line "deck path player {player}", separated by spaces
+ * @param index Where the game came in the input
+ * @param decks The decks loaded so far
+ * @param paths The path files loaded so far
+ * @return The game, with its players at the start
+ */
+BatchGame *read_game(char *line, int index, Loaded **decks, Loaded **paths) {
+    char *words[3 + MAX_PLAYERS];
+    int numWords = 0;
+    char *save;
+    for (char *word = strtok_r(line, " \t\n", &save); word != NULL;
+            word = strtok_r(NULL, " \t\n", &save)) {
+        if (numWords == 2 + MAX_PLAYERS) {
+            batch_exit(INVALID_BATCH_GAME);
+        }
+        words[numWords] = word;
+        numWords += 1;
+    }
+    int numPlayers = numWords - 2;
+    if (numPlayers < 1) {
+        batch_exit(INVALID_BATCH_GAME);
+    }
+
+    BatchGame *game = malloc(sizeof(BatchGame));
+    game->index = index;
+    game->playsB = malloc(sizeof(bool) * numPlayers);
+    for (int i = 0; i < numPlayers; ++i) {
+        game->playsB[i] = plays_b(words[i + 2]);
+    }
+
+    // the deck is checked first, as the dealer does
+    batch_deck(game, decks, words[0]);
+    game->drawn = 0;
+
+    Path *path = batch_path(paths, words[1], numPlayers);
+    path->players = malloc(sizeof(Player *) * numPlayers);
+    for (int i = 0; i < numPlayers; ++i) {
+        path->players[i] = init_player(path, i);
+    }
+    arrange_order_of_players(path);
+    game->path = path;
+    return game;
+}
+
+/** Keeps a finished game's scores and frees the game.
+ *
+ * @param game The finished game
+ * @param results Set to the Scores: line of each game, by index
+ */
+void finish_game(BatchGame *game, char **results) {
+    char *scores;
+    size_t length;
+    FILE *stream = open_memstream(&scores, &length);
+    game_over(game->path, stream);
+    fclose(stream);
+    results[game->index] = scores;
+
+    free_path(game->path);
+    if (game->ownsCards) {
+        free((char *) game->cards);
+    }
+    free(game->playsB);
+    free(game);
+}
+
+/** Plays the games given on stdin, one per line as the dealer's arguments
+ *  with A and B for the players, without starting any player processes.
+ *  Prints the Scores: line the dealer would print for each, in order.
+ */
+int main(int argc, char **argv) {
+    int lanes = DEFAULT_LANES;
+    if (argc > 2) {
+        batch_exit(INVALID_BATCH_ARGS);
+    }
+    if (argc == 2) {
+        char *end;
+        lanes = (int) strtol(argv[1], &end, 10);
+        if (*argv[1] == '\0' || *end != '\0' || lanes < 1) {
+            batch_exit(INVALID_BATCH_ARGS);
+        }
+    }
+
+    Batch *batch = create_batch(lanes);
+    BatchGame **finished = malloc(sizeof(BatchGame *) * lanes);
+    Loaded *decks = NULL;
+    Loaded *paths = NULL;
+    char **results = NULL;
+    int numGames = 0;
+    int numPrinted = 0;
+    bool inputEnded = false;
+    char *line = NULL;
+    size_t lineSize = 0;
+
+    while (true) {
+        // keep every lane busy while there are games left
+        while (!inputEnded && batch->active < batch->lanes) {
+            if (getline(&line, &lineSize, stdin) == -1) {
+                inputEnded = true;
+                break;
+            }
+            if (strspn(line, " \t\n") == strlen(line)) {
+                continue;
+            }
+            results = realloc(results, sizeof(char *) * (numGames + 1));
+            results[numGames] = NULL;
+            batch_add(batch, read_game(line, numGames, &decks, &paths));
+            numGames += 1;
+        }
+        if (inputEnded && batch->active == 0) {
+            break;
+        }
+
+        int numFinished = batch_step(batch, finished);
+        for (int i = 0; i < numFinished; ++i) {
+            finish_game(finished[i], results);
+        }
+        for (; numPrinted < numGames && results[numPrinted] != NULL;
+                ++numPrinted) {
+            fputs(results[numPrinted], stdout);
+            free(results[numPrinted]);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef BATCH_PROGRAM_H
+#define BATCH_PROGRAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "util.h"
+#include "path.h"
+#include "deck.h"
+#include "compiled.h"
+#include "batch.h"
+
+// lanes used when none are given
+#define DEFAULT_LANES 256
+
+/** All error codes 2310batch can exit with. **/
+typedef enum BatchErrorCodes {
+    INVALID_BATCH_ARGS = 1,
+    INVALID_BATCH_DECK = 2,
+    INVALID_BATCH_PATH = 3,
+    INVALID_BATCH_GAME = 4
+} BatchErrorCode;
+
+/** A deck or path file loaded for an earlier game. **/
+typedef struct Loaded {
+    char *fileName;
+
+    // the first line of a path file, or a deck's cards in draw order
+    char *contents;
+    int numCards;
+
+    struct Loaded *next;
+} Loaded;
+
+#endif
@@ -1,5 +1,9 @@
+#define _GNU_SOURCE
 #include "2310dealer.h"
 
+// how many games this dealer has made, which numbers them
+static int gamesMade = 0;
+
 /** Sets up pipes.
  *
  * @param sendPipe send fd's
@@ -26,64 +30,48 @@ void child_setup(int sendPipe[2], int receivePipe[2], char *programName,
 
     execl(programName, programName, numPlayers, playerID, NULL);
 
-    // if we get here, exec failed.
-    close(STDIN_FILENO);
-    close(STDOUT_FILENO);
-//    exit(0);
-    kill(getppid(), SIGABRT);
+    // if we get here, exec failed; the dealer sees this player's pipe
+    // close before its carat. _exit, as the dealer's buffers and exit
+    // handlers are not this process's to run
+    _exit(ERROR_STARTING_PLAYER);
 }
 
-/** Closes pipes and creates reader/writers. **/
-void create_reader_writers(Player *player) {
+/** Closes the player's ends of its pipes, which the dealer has no use for,
+ *  and makes the dealer's ends non-blocking so that no player can hold up
+ *  the dealer.
+ *
+ * @param player The player
+ */
+void keep_dealer_ends(Player *player) {
     close(player->sendPipes[WRITE_END]);
     close(player->receivePipes[READ_END]);
+    player->sendPipes[WRITE_END] = -1;
+    player->receivePipes[READ_END] = -1;
 
-    // write to this to talk to player
-    player->writer = fdopen(player->receivePipes[WRITE_END], "w");
-
-    // read from this to read from player
-    player->reader = fdopen(player->sendPipes[READ_END], "r");
+    fcntl(FROM_PLAYER(player), F_SETFL, O_NONBLOCK);
+    fcntl(TO_PLAYER(player), F_SETFL, O_NONBLOCK);
 }
 
-/** Checks the stream for a carat. **/
-int check_carat(Player *player, char *givenPath) {
-    char carat = fgetc(player->reader);
-    if (carat == '^') {
-        fprintf(player->writer, "%s\n", givenPath);
-        fflush(player->writer);
-        return 0;
+/** Makes sure the dealer may open enough fds for every player's pipes,
+ *  raising its soft limit as far as the hard limit allows.
+ *
+ * @param numPlayers The number of players
+ * @return false if the players can't all be given pipes
+ */
+bool fit_fd_limit(int numPlayers) {
+    rlim_t needed = (rlim_t) numPlayers * FDS_PER_PLAYER + SPARE_FDS;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        return false;
     }
-    dealer_exit(ERROR_STARTING_PLAYER);
-    return 1;
-}
-
-/** Checks if the deck file is valid. **/
-DealerErrorCode check_deck_file(char *deckFileName) {
-    char *line = read_line(fopen(deckFileName, "r"));
-
-    // get number of cards
-    char *trash;
-    char buff[5];
-    snprintf(buff, 5, "%s", &line[0]);
-    int numberOfCards = (int) strtol(buff, &trash, 10);
-
-    if (numberOfCards < 4) {
-        dealer_exit(INVALID_DECK_FILE);
+    if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= needed) {
+        return true;
     }
-    char *validChars = "ABCDE";
-
-    char str[2] = "\0";
-    for (int i = 1; i < strlen(line); ++i) {
-        str[0] = line[i];
-        if (strstr(validChars, str) == NULL) {
-            dealer_exit(INVALID_DECK_FILE);
-        }
-        if (i > numberOfCards) {
-            dealer_exit(INVALID_DECK_FILE);
-        }
+    if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < needed) {
+        return false;
     }
-
-    return NO_ERROR;
+    limit.rlim_cur = needed;
+    return setrlimit(RLIMIT_NOFILE, &limit) == 0;
 }
 
 /** Checks the dealer's args.
@@ -93,24 +81,14 @@ DealerErrorCode check_deck_file(char *deckFileName) {
  * @return NO_ERROR on success
  */
 DealerErrorCode check_dealer_args(int argc, char **argv) {
-    char *deckFileName = argv[1];
-    char *mapFileName = argv[2];
-
-    // 9 players max + deck + path + program name
-    if (argc > 3 + 9) {
+    // MAX_PLAYERS players max + deck + path + program name
+    if (argc > 3 + MAX_PLAYERS) {
         dealer_exit(INVALID_NUM_ARGS);
     }
 
     if (argc < 4) {
         dealer_exit(INVALID_NUM_ARGS);
     }
-    FILE *file = fopen(mapFileName, "r");
-    check_deck_file(deckFileName);
-    check_map_file(read_line(file), DEALER);
-
-    if (fgetc(file) == '\n') {
-        dealer_exit(INVALID_PATH_FILE);
-    }
 
     return NO_ERROR;
 }
@@ -120,58 +98,100 @@ DealerErrorCode check_dealer_args(int argc, char **argv) {
  * @param numPlayers Number of players in game
  * @param path The game path
  * @param argv argv
+ * @return false if a player could not be forked
  */
-void make_forks(int numPlayers, Path *path, char **argv) {
-    int cPID = fork();
-    char childArgsNumPlayers[2];
-    char childArgsID[2];
-
-    snprintf(childArgsNumPlayers, 2, "%d", numPlayers);
-
-    // if child
-    if (cPID == 0) {
-        for (int i = 1; i < numPlayers; ++i) {
-            // we are another clone
-            if (fork() == 0) {
-                snprintf(childArgsID, 2, "%d", i);
-                Player *player = path->players[i];
-                child_setup(player->sendPipes, player->receivePipes,
-                        argv[i + 3], childArgsNumPlayers, childArgsID);
+bool make_forks(int numPlayers, Path *path, char **argv) {
+    char childArgsNumPlayers[12];
+    char childArgsID[12];
+
+    snprintf(childArgsNumPlayers, sizeof(childArgsNumPlayers), "%d",
+            numPlayers);
+    path->programs = &argv[3];
+
+    // every player is the dealer's own child, so it can be reaped
+    bool forked = true;
+    for (int i = 0; i < numPlayers && forked; ++i) {
+        Player *player = path->players[i];
+        pid_t cPID = fork();
+        if (cPID == 0) {
+            // the dealer ignores SIGPIPE; players should not
+            signal(SIGPIPE, SIG_DFL);
+            if (path->mirror != NULL) {
+                share_mirror(path->mirror);
             }
+            snprintf(childArgsID, sizeof(childArgsID), "%d", i);
+            child_setup(player->sendPipes, player->receivePipes,
+                    argv[i + 3], childArgsNumPlayers, childArgsID);
         }
-        Player *player = path->players[0];
-        child_setup(player->sendPipes, player->receivePipes, argv[3],
-                childArgsNumPlayers, "0");
+        path->usage[i].pid = cPID;
+        forked = cPID != -1;
     }
 
     for (int i = 0; i < numPlayers; ++i) {
-        create_reader_writers(path->players[i]);
+        keep_dealer_ends(path->players[i]);
     }
+    return forked;
 }
 
-/** Initialises the dealer.
+/** Initialises the dealer, loading the deck and path files through their
+ *  compiled forms. Exits if either is invalid, the deck first.
  *
- * @param givenPath The contents of the pathfile
+ * @param deckFileName The deck file name, or a seed:... spec
+ * @param mapFileName The path file name
  * @param numPlayers The number of players
- * @param deckFileName The deck file name
+ * @param givenPath Set to the contents of the pathfile
  * @return an initialised Path
  */
-Path *initialise_dealer(char *givenPath, int numPlayers, char *deckFileName) {
+Path *initialise_dealer(char *deckFileName, char *mapFileName,
+        int numPlayers, char **givenPath) {
+    Deck *deck = load_deck(deckFileName);
+    if (deck == NULL) {
+        dealer_exit(INVALID_DECK_FILE);
+    }
+    Path *path = load_path(mapFileName, numPlayers, givenPath);
+    if (path == NULL) {
+        dealer_exit(INVALID_PATH_FILE);
+    }
+
     // do initialisation
-    Path *path = allocate_path(givenPath, numPlayers);
+    path->deck = deck;
+    if (!setup_players(path, numPlayers)) {
+        dealer_exit(ERROR_STARTING_PLAYER);
+    }
+
+    return path;
+}
+
+/** Adds the players and their pipes to an allocated path. Every pipe is
+ *  closed on exec, so a player only holds the ends it is given as its
+ *  stdin and stdout. Pipes which were not made are left as -1.
+ *
+ * @param path The game path
+ * @param numPlayers The number of players
+ * @return false if there are too many players for the fds the dealer may
+ * open, or their pipes could not all be made
+ */
+bool setup_players(Path *path, int numPlayers) {
     path->players = malloc(sizeof(Player *) * numPlayers);
-    path->deck = allocate_deck(fopen(deckFileName, "r"));
+    path->usage = calloc(numPlayers, sizeof(SeatUsage));
+    path->broadcast = create_broadcast(numPlayers);
 
+    bool made = fit_fd_limit(numPlayers);
     for (int i = 0; i < numPlayers; ++i) {
-        path->players[i] = init_player(path, i);
-        // make pipes
-
-        pipe(path->players[i]->sendPipes);
-        pipe(path->players[i]->receivePipes);
+        Player *player = init_player(path, i);
+        path->players[i] = player;
+        for (int end = READ_END; end <= WRITE_END; ++end) {
+            player->sendPipes[end] = -1;
+            player->receivePipes[end] = -1;
+        }
+        if (made && (pipe2(player->sendPipes, O_CLOEXEC) == -1 ||
+                pipe2(player->receivePipes, O_CLOEXEC) == -1)) {
+            made = false;
+        }
     }
     arrange_order_of_players(path);
-
-    return path;
+    path->mirror = create_mirror(path);
+    return made;
 }
 
 
@@ -183,6 +203,12 @@ int main(int argc, char **argv) {
     if ((intptr_t) signal(SIGHUP, sig_handler) == SIGHUP) {
         dealer_exit(COMMUNICATION_ERROR);
     }
+    // a player which has gone is found by its pipe's writes failing
+    signal(SIGPIPE, SIG_IGN);
+    create_metrics();
+    if (argc == 3 && strcmp(argv[1], SERVE_FLAG) == 0) {
+        return serve(argv[2]);
+    }
     // arg checking
     check_dealer_args(argc, argv);
 
@@ -191,106 +217,629 @@ int main(int argc, char **argv) {
 
     // first three args are not players
     int numPlayers = argc - 3;
-    char *givenPath = read_line(fopen(mapFileName, "r"));
-    Path *path = initialise_dealer(givenPath, numPlayers, deckFileName);
+    char *givenPath;
+    Path *path = initialise_dealer(deckFileName, mapFileName, numPlayers,
+            &givenPath);
 
-    make_forks(numPlayers, path, argv);
+    if (!make_forks(numPlayers, path, argv)) {
+        dealer_exit(ERROR_STARTING_PLAYER);
+    }
+    path->spectators = create_spectators(givenPath);
+    Stats *stats = create_stats();
+    path->stats = start_game_stats(stats, &argv[3], numPlayers);
 
     start_dealer(path, givenPath);
+    if (stats != NULL) {
+        write_stats_report(stats, getenv(STATS_ENV));
+    }
 
     return 0;
 }
 
-/** Sends HAPs to players and prints to dealer stdout. **/
-void send_to_player(Path *path, Player *player, int oldPoints, int oldMoney,
-        int cardIndexHap) {
+/** Sends HAPs to players and prints to dealer stdout, or records the move
+ *  in the transcript. **/
+void send_to_player(Path *path, Player *player, int oldSite, int oldPoints,
+        int oldMoney, int cardIndexHap) {
     int playerId = player->id;
     int newPoints = player->points - oldPoints;
     int newMoney = player->money - oldMoney;
-    print_player_details(path, playerId, stdout);
-    fflush(stdout);
+    TRACE_BEGIN("render", playerId);
+    if (path->transcript != NULL) {
+        record_turn(path->transcript, playerId,
+                player->siteNumber - oldSite, newPoints, newMoney,
+                cardIndexHap);
+    } else {
+        print_player_details(path, playerId, path->log);
+        fflush(path->log);
+    }
+    TRACE_END("render", playerId);
 
     // send haps to players
-    for (int j = 0; j < path->playersInGame; ++j) {
-        fprintf(path->players[j]->writer, "HAP%d,%d,%d,%d,%d\n",
-                playerId, player->siteNumber, newPoints, newMoney,
+    TRACE_BEGIN("hap_broadcast", playerId);
+    char hap[80];
+    int length = snprintf(hap, sizeof(hap), "HAP%d,%d,%d,%d,%d\n",
+            playerId, player->siteNumber, newPoints, newMoney,
+            cardIndexHap);
+    broadcast_line(path, hap, length);
+    TRACE_END("hap_broadcast", playerId);
+
+    if (path->spectators != NULL) {
+        spectate_turn(path->spectators, path, player, newPoints, newMoney,
                 cardIndexHap);
-        fflush(path->players[j]->writer);
     }
 }
 
-/** Checks if all player have sent their carats. **/
-void check_players_carats(Path *path, char *givenPath) {
-    for (int playerID = 0; playerID < path->playersInGame; ++playerID) {
-        if (check_carat(path->players[playerID], givenPath) == 1) {
-            exit(9);
-        }
-    }
+/** Stops the game. Its players are reaped as they exit, and each
+ *  player's pipe is closed once it has been sent everything queued for it.
+ *
+ * @param game The game
+ * @param error Why the game ended, or NO_ERROR if it was played out
+ */
+void stop_game(Game *game, DealerErrorCode error) {
+    game->error = error;
+    game->phase = AWAIT_EXIT;
+    clock_gettime(CLOCK_MONOTONIC, &game->ended);
 }
 
 /** Prints the endgame and sends endgame to players.
  *
- * @param path The game path
+ * @param game The game
  */
-void clean_up_game(Path *path) {
-    game_over(path, stdout);
+void clean_up_game(Game *game) {
+    Path *path = game->path;
+    struct timespec ending;
+    clock_gettime(CLOCK_MONOTONIC, &ending);
+    // before game_over, which uses up the players' cards
+    if (path->spectators != NULL) {
+        spectate_end(path->spectators, path);
+        path->spectators = NULL;
+    }
+    if (path->stats != NULL) {
+        int scores[path->playersInGame];
+        for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+            scores[playerId] = final_score(path->players[playerId]);
+        }
+        finish_game_stats(path->stats, scores);
+    }
+    if (path->transcript != NULL) {
+        record_end(path->transcript);
+    } else {
+        game_over(path, path->log);
+        fflush(path->log);
+        drain_log();
+    }
 
     // send DONE to players
-    for (int j = 0; j < path->playersInGame; ++j) {
-        fprintf(path->players[j]->writer, "DONE\n");
-        fflush(path->players[j]->writer);
+    broadcast_line(path, "DONE\n", strlen("DONE\n"));
+    stop_game(game, NO_ERROR);
+    game->ended = ending;
+}
+
+/** Tells the players the game is over because a player broke the rules
+ *  or left, and stops it.
+ *
+ * @param game The game
+ */
+void end_game_early(Game *game) {
+    broadcast_line(game->path, "EARLY\n", strlen("EARLY\n"));
+    stop_game(game, COMMUNICATION_ERROR);
+}
+
+/** Closes the pipes to players which have been sent everything, so that
+ *  any player still reading sees the end of its input.
+ *
+ * @param game The game
+ */
+void close_sent_pipes(Game *game) {
+    Path *path = game->path;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        Player *player = path->players[playerId];
+        if (TO_PLAYER(player) != -1 && !output_waiting(path, playerId)) {
+            close(TO_PLAYER(player));
+            TO_PLAYER(player) = -1;
+        }
+    }
+}
+
+/** Closes what is left of a stopped game's pipes and accounts for its
+ *  players, once they have all been reaped or REAP_TIMEOUT_MS has passed.
+ *
+ * @param game The game
+ */
+void finish_game(Game *game) {
+    Path *path = game->path;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        Player *player = path->players[playerId];
+        for (int end = READ_END; end <= WRITE_END; ++end) {
+            if (player->sendPipes[end] != -1) {
+                close(player->sendPipes[end]);
+                player->sendPipes[end] = -1;
+            }
+            if (player->receivePipes[end] != -1) {
+                close(player->receivePipes[end]);
+                player->receivePipes[end] = -1;
+            }
+        }
+    }
+
+    char *usageFile = getenv(USAGE_ENV);
+    if (usageFile != NULL) {
+        write_usage(path, usageFile, game->id,
+                game->error == NO_ERROR ? NORMAL_END : game->error);
+    }
+    if (game->error == NO_ERROR) {
+        count_game_finished();
+        observe_phase(PHASE_END, elapsed_nanos(&game->ended));
     }
+    count_players(-path->playersInGame);
+    game->phase = GAME_FINISHED;
 }
 
-/** Starts a dealer session.
+/** Makes the move a player sent and tells everyone about it.
  *
  * @param path The game path
- * @param givenPath The contents of the path file
- * @return 0 when game has ended
+ * @param playerID The player who was sent YT
+ * @param input The player's reply
+ * @return false if the move was not allowed
  */
-int start_dealer(Path *path, char *givenPath) {
-    check_players_carats(path, givenPath);
-    print_path(path, stdout);
+bool do_move(Path *path, int playerID, char *input) {
+    // recieved DO
+    if (strncmp("DO", input, 2) == 0) {
+        // the site number is all of the rest of the line, so signs and
+        // padding break the protocol
+        char *end;
+        long siteNumber = strtol(&input[2], &end, 10);
+        if (input[2] < '0' || input[2] > '9' || *end != '\0') {
+            return false;
+        }
 
-    // main loop
-    while (check_game_over(path) != 0) {
-        int nextMovePlayerID = next_player_to_move(path);
-        fprintf(path->players[nextMovePlayerID]->writer, "YT\n");
-        fflush(path->players[nextMovePlayerID]->writer);
-        // wait for dealer input
-        char *input = read_line(path->players[nextMovePlayerID]->reader);
+        Player *player = path->players[playerID];
+        // only forward, up to the next barrier, to a site with room
+        if (siteNumber <= player->siteNumber || siteNumber >
+                find_next_barrier(path, player->siteNumber) ||
+                available(path->sites[siteNumber]) != 0) {
+            return false;
+        }
 
-        int playerID = next_player_to_move(path);
+        // for HAP
+        int oldSite = player->siteNumber;
+        int oldPoints = player->points;
+        int oldMoney = player->money;
+
+        TRACE_BEGIN("move_player", playerID);
+        move_player(path, playerID, (int) siteNumber - player->siteNumber,
+                DEALER);
+        TRACE_END("move_player", playerID);
+
+        Site *site = &path->sites[player->siteNumber];
+
+        // do Ri type
+        int cardIndexHAP = 0;
+        if (strcmp(site->type, RI) == 0) {
+            TRACE_BEGIN("do_ri", playerID);
+            cardIndexHAP = do_ri(path, player);
+            TRACE_END("do_ri", playerID);
+            if (path->stats != NULL) {
+                count_card(path->stats, cardIndexHAP);
+            }
+        }
+        if (path->mirror != NULL) {
+            publish_mirror(path->mirror, path);
+        }
+        send_to_player(path, player, oldSite, oldPoints, oldMoney,
+                cardIndexHAP);
+    }
+    return true;
+}
 
-        // recieved DO
-        char read[5];
-        char *ptr;
-        snprintf(read, 3, "%s", &input[0]);
+/** Makes a game which is waiting for the first player's carat.
+ *
+ * @param path The game path, with the players started
+ * @param givenPath The contents of the path file, which the game borrows
+ * @return The game
+ */
+Game *create_game(Path *path, char *givenPath) {
+    int numPlayers = path->playersInGame;
+    Game *game = malloc(sizeof(Game));
+    game->path = path;
+    game->id = ++gamesMade;
+    game->givenPath = givenPath;
+    game->phase = AWAIT_CARAT;
+    game->waitingOn = 0;
+    game->error = NO_ERROR;
+    game->inputs = malloc(sizeof(char *) * numPlayers);
+    game->inputLengths = calloc(numPlayers, sizeof(size_t));
+    game->closed = calloc(numPlayers, sizeof(bool));
+    game->polled = malloc(sizeof(int) * (numPlayers + 1));
+
+    for (int playerId = 0; playerId < numPlayers; ++playerId) {
+        game->inputs[playerId] = NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &game->turnStarted);
+    count_game_started();
+    count_players(numPlayers);
+    return game;
+}
 
-        // find sitenumber
-        if (strcmp("DO", read) == 0) {
-            snprintf(read, 5, "%s", &input[2]);
-            int siteNumber = (int) strtol(read, &ptr, 10);
+/** Frees a finished game, along with its path, deck and everything else
+ *  the game made for itself.
+ *
+ * @param game The game
+ */
+void free_game(Game *game) {
+    Path *path = game->path;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        free(game->inputs[playerId]);
+    }
+    free(game->inputs);
+    free(game->inputLengths);
+    free(game->closed);
+    free(game->polled);
+
+    if (path->transcript != NULL) {
+        // a game which ended early never wrote its end
+        if (path->transcript->file != NULL) {
+            fclose(path->transcript->file);
+        }
+        free(path->transcript);
+    }
+    if (path->spectators != NULL) {
+        // a game which ended early never sent its scores
+        free_spectators(path->spectators);
+    }
+    if (path->mirror != NULL) {
+        free_mirror(path->mirror);
+    }
+    free(path->stats);
+    free(path->usage);
+    free_broadcast(path->broadcast);
+    free_deck(path->deck);
+    free_path(path);
+    free(game);
+}
+
+/** Reads whatever the player has sent, without blocking.
+ *
+ * @param game The game
+ * @param playerId The player to read from
+ */
+void fill_input(Game *game, int playerId) {
+    char buffer[GAME_READ_SIZE];
+    ssize_t got = read(FROM_PLAYER(game->path->players[playerId]), buffer,
+            sizeof(buffer));
+    if (got == 0) {
+        game->closed[playerId] = true;
+    }
+    if (got <= 0) {
+        return;
+    }
+
+    size_t length = game->inputLengths[playerId];
+    game->inputs[playerId] = realloc(game->inputs[playerId], length + got);
+    memcpy(&game->inputs[playerId][length], buffer, got);
+    game->inputLengths[playerId] = length + got;
+}
+
+/** Removes the first count bytes of the player's input.
+ *
+ * @param game The game
+ * @param playerId The player
+ * @param count The number of bytes to remove
+ */
+void consume_input(Game *game, int playerId, size_t count) {
+    game->inputLengths[playerId] -= count;
+    memmove(game->inputs[playerId], &game->inputs[playerId][count],
+            game->inputLengths[playerId]);
+}
+
+/** Takes the next line the player sent, the way read_line() would. More
+ *  than MAX_MOVE_LENGTH bytes without a newline are taken as the line, as
+ *  no move is that long.
+ *
+ * @param game The game
+ * @param playerId The player
+ * @return The line, or NULL if the player has not sent a whole line yet.
+ */
+char *take_line(Game *game, int playerId) {
+    char *input = game->inputs[playerId];
+    size_t length = game->inputLengths[playerId];
+    char *newline = length > 0 ? memchr(input, '\n', length) : NULL;
+
+    size_t lineLength;
+    if (newline != NULL) {
+        lineLength = newline - input;
+    } else if (game->closed[playerId] || length > MAX_MOVE_LENGTH) {
+        lineLength = length;
+    } else {
+        return NULL;
+    }
+
+    if (lineLength == 0) {
+        consume_input(game, playerId, newline != NULL ? 1 : 0);
+        return strdup("\a");
+    }
+    char *line = strndup(input, lineLength);
+    consume_input(game, playerId, lineLength + (newline != NULL ? 1 : 0));
+    return line;
+}
+
+/** Ends the game if everyone is at the final barrier, otherwise sends YT
+ *  to the next player and waits for their move.
+ *
+ * @param game The game
+ */
+void begin_turn(Game *game) {
+    Path *path = game->path;
+    if (check_game_over(path) == 0) {
+        clean_up_game(game);
+        return;
+    }
+
+    int nextMovePlayerID = next_player_to_move(path);
+    TRACE_BEGIN("yt_send", nextMovePlayerID);
+    send_line(path, nextMovePlayerID, "YT\n", strlen("YT\n"));
+    TRACE_END("yt_send", nextMovePlayerID);
+    clock_gettime(CLOCK_MONOTONIC, &game->turnStarted);
+    TRACE_BEGIN("do_receive", nextMovePlayerID);
+    game->phase = AWAIT_MOVE;
+    game->waitingOn = nextMovePlayerID;
+}
+
+/** Takes a player's carat and sends it the path, starting the first turn
+ *  once every player has been sent the path.
+ *
+ * @param game The game
+ * @param playerId The player the game is waiting on
+ */
+void take_carat(Game *game, int playerId) {
+    Path *path = game->path;
+    char carat = game->inputs[playerId][0];
+    consume_input(game, playerId, 1);
+    if (carat != '^') {
+        stop_game(game, ERROR_STARTING_PLAYER);
+        return;
+    }
+    size_t length = strlen(game->givenPath);
+    char *line = malloc(length + 1);
+    memcpy(line, game->givenPath, length);
+    line[length] = '\n';
+    send_line(path, playerId, line, length + 1);
+    free(line);
+
+    game->waitingOn += 1;
+    if (game->waitingOn == path->playersInGame) {
+        if (path->transcript == NULL) {
+            // so a generated deck can be made again
+            if (path->deck->seed != NULL) {
+                fprintf(path->log, "Deck %s\n", path->deck->seed);
+            }
+            print_path(path, path->log);
+        }
+        observe_phase(PHASE_START, elapsed_nanos(&game->turnStarted));
+        begin_turn(game);
+    }
+}
+
+/** Makes the move the player sent, ending the game early if the player
+ *  broke the rules or left, and starts the next turn.
+ *
+ * @param game The game
+ * @param playerId The player who was sent YT
+ * @param input The player's reply
+ */
+void take_move(Game *game, int playerId, char *input) {
+    Path *path = game->path;
+    // the player left without making a move
+    if (game->closed[playerId] && game->inputLengths[playerId] == 0 &&
+            strcmp(input, "\a") == 0) {
+        end_game_early(game);
+        return;
+    }
+    TRACE_END("do_receive", playerId);
+    int64_t thinkNanos = elapsed_nanos(&game->turnStarted);
+    path->usage[playerId].thinkNanos += thinkNanos;
+    path->usage[playerId].moves += 1;
+    observe_phase(PHASE_THINK, thinkNanos);
+
+    struct timespec moving;
+    clock_gettime(CLOCK_MONOTONIC, &moving);
+    if (!do_move(path, playerId, input)) {
+        end_game_early(game);
+        return;
+    }
+    observe_phase(PHASE_MOVE, elapsed_nanos(&moving));
+    count_turn();
+    begin_turn(game);
+}
+
+/** Runs the game as far as it can go with the input it has, stopping when
+ *  it needs more from a player, is waiting for its players to exit or has
+ *  finished.
+ *
+ * @param game The game
+ */
+void advance_game(Game *game) {
+    Path *path = game->path;
+    while (true) {
+        int playerId = game->waitingOn;
+        bool playing = game->phase == AWAIT_CARAT ||
+                game->phase == AWAIT_MOVE;
+
+        if (playing && path->broadcast->failed) {
+            // a player's pipe was closed while it was still in the game
+            end_game_early(game);
+        } else if (game->phase == AWAIT_CARAT) {
+            if (game->inputLengths[playerId] == 0) {
+                if (!game->closed[playerId]) {
+                    return;
+                }
+                stop_game(game, ERROR_STARTING_PLAYER);
+                continue;
+            }
+            take_carat(game, playerId);
+        } else if (game->phase == AWAIT_MOVE) {
+            char *input = take_line(game, playerId);
+            if (input == NULL) {
+                return;
+            }
+            take_move(game, playerId, input);
+            free(input);
+        } else if (game->phase == AWAIT_EXIT) {
+            close_sent_pipes(game);
+            if (reap_exited_players(path) > 0 &&
+                    elapsed_nanos(&game->ended) <
+                    (int64_t) REAP_TIMEOUT_MS * 1000000) {
+                return;
+            }
+            finish_game(game);
+        } else {
+            return;
+        }
+    }
+}
 
-            Player *player = path->players[playerID];
+/** Fills in the fds the game is waiting on: the pipe from the player it
+ *  needs input from, then the pipe to every player with output waiting.
+ *
+ * @param game The game
+ * @param fds Where to put them; room for GAME_MAX_FDS(game)
+ * @return How many fds were filled in
+ */
+int game_poll_fds(Game *game, struct pollfd *fds) {
+    Path *path = game->path;
+    int count = 0;
+    if (game->phase == AWAIT_CARAT || game->phase == AWAIT_MOVE) {
+        fds[count].fd = FROM_PLAYER(path->players[game->waitingOn]);
+        fds[count].events = POLLIN;
+        game->polled[count] = game->waitingOn;
+        count += 1;
+    }
+    if (game->phase == GAME_FINISHED) {
+        return count;
+    }
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        int fd = TO_PLAYER(path->players[playerId]);
+        if (fd != -1 && output_waiting(path, playerId)) {
+            fds[count].fd = fd;
+            fds[count].events = POLLOUT;
+            game->polled[count] = playerId;
+            count += 1;
+        }
+    }
+    return count;
+}
 
-            // for HAP
-            int oldPoints = player->points;
-            int oldMoney = player->money;
+/** Returns how long poll() may wait before the game has to be run again
+ *  whether or not its fds are ready.
+ *
+ * @param game The game
+ * @return Milliseconds, or -1 for as long as it takes
+ */
+int game_timeout(Game *game) {
+    // exited players are looked for every millisecond
+    return game->phase == AWAIT_EXIT ? 1 : -1;
+}
+
+/** Returns the sooner of two poll() timeouts.
+ *
+ * @param timeout A timeout in milliseconds, or -1 for none
+ * @param other Another timeout
+ * @return The sooner of the two
+ */
+int sooner_timeout(int timeout, int other) {
+    if (timeout == -1 || (other != -1 && other < timeout)) {
+        return other;
+    }
+    return timeout;
+}
 
-            move_player(path, playerID, siteNumber - player->siteNumber,
-                    DEALER);
+/** Reads from and writes to whichever of the game's fds poll() found
+ *  ready, then runs the game as far as it can go.
+ *
+ * @param game The game
+ * @param fds The fds game_poll_fds() filled in, after poll()
+ * @param count How many fds it filled in
+ */
+void service_game(Game *game, struct pollfd *fds, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+        if (fds[i].events == POLLIN) {
+            fill_input(game, game->polled[i]);
+        } else {
+            flush_output(game->path, game->polled[i]);
+        }
+    }
+    advance_game(game);
+}
 
-            Site *site = &path->sites[player->siteNumber];
+/** Runs every game to the end, resuming whichever games have input from
+ *  the player they are waiting on or room in a pipe they have output for.
+ *  A slow or broken player only holds up or ends its own game.
+ *
+ * @param games The games
+ * @param count The number of games
+ */
+void run_games(Game **games, int count) {
+    int maxFds = 0;
+    for (int i = 0; i < count; ++i) {
+        advance_game(games[i]);
+        maxFds += GAME_MAX_FDS(games[i]);
+    }
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * maxFds);
+    int firstFd[count];
+    int numFds[count];
+
+    while (true) {
+        int used = 0;
+        int active = 0;
+        int timeout = -1;
+        for (int i = 0; i < count; ++i) {
+            if (games[i]->phase == GAME_FINISHED) {
+                continue;
+            }
+            active += 1;
+            firstFd[i] = used;
+            numFds[i] = game_poll_fds(games[i], &fds[used]);
+            used += numFds[i];
+            timeout = sooner_timeout(timeout, game_timeout(games[i]));
+        }
+        if (active == 0) {
+            break;
+        }
 
-            // do Ri type
-            int cardIndexHAP = 0;
-            if (strcmp(site->type, RI) == 0) {
-                cardIndexHAP = do_ri(path->deck, player);
+        if (poll(fds, used, timeout) == -1) {
+            continue;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (games[i]->phase != GAME_FINISHED) {
+                service_game(games[i], &fds[firstFd[i]], numFds[i]);
             }
-            send_to_player(path, player, oldPoints, oldMoney, cardIndexHAP);
         }
     }
-    clean_up_game(path);
+    free(fds);
+}
+
+/** Starts a dealer session, exiting with the game's error if it ended
+ *  early.
+ *
+ * @param path The game path
+ * @param givenPath The contents of the path file
+ * @return 0 when game has ended
+ */
+int start_dealer(Path *path, char *givenPath) {
+    path->log = open_log(stdout);
+    start_trace("2310dealer");
+    path->transcript = create_transcript(givenPath, path->deck,
+            path->playersInGame);
+    Game *game = create_game(path, givenPath);
+    run_games(&game, 1);
+    if (game->error != NO_ERROR) {
+        if (path->spectators != NULL) {
+            free_spectators(path->spectators);
+        }
+        dealer_exit(game->error);
+    }
     return 0;
 }
@@ -1,9 +1,6 @@
 #ifndef DEALER_H
 #define DEALER_H
 
-#define READ_END 0
-#define WRITE_END 1
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,8 +10,87 @@
 #include "util.h"
 #include "path.h"
 #include "deck.h"
+#include "server.h"
+#include "metrics.h"
+#include <poll.h>
+#include <sys/resource.h>
+
+// the most bytes read from a player at once
+#define GAME_READ_SIZE 4096
+
+// the longest move a player can send: "DO" and an int site number
+#define MAX_MOVE_LENGTH 12
+
+// fds the dealer holds for each player while starting them, and fds kept
+// for everything else it opens
+#define FDS_PER_PLAYER 4
+#define SPARE_FDS 32
+
+// the dealer's end of the pipe it reads a player's output from
+#define FROM_PLAYER(player) ((player)->sendPipes[READ_END])
+
+/** What a game is waiting for. **/
+typedef enum GamePhase {
+    AWAIT_CARAT,
+    AWAIT_MOVE,
+    // the players have been told the game is over and are being reaped
+    AWAIT_EXIT,
+    GAME_FINISHED
+} GamePhase;
+
+/** A game run by the dealer as a state machine, so that it can be put
+ *  aside while it waits on a player and resumed once the player has sent
+ *  something. Whatever goes wrong in a game only ends that game.
+ */
+typedef struct Game {
+    // the game path, and the game's number among those this dealer has
+    // run, from 1
+    Path *path;
+    int id;
+
+    // the contents of the path file, sent to each player
+    char *givenPath;
+
+    // what the game is waiting for
+    GamePhase phase;
+
+    // the player the game is waiting on, and when it was sent YT, or when
+    // the game was made while waiting for carats
+    int waitingOn;
+    struct timespec turnStarted;
+
+    // why the game ended, or NO_ERROR if it was played to the end, and
+    // when the players were told it was over
+    DealerErrorCode error;
+    struct timespec ended;
+
+    // bytes read from each player which have not been used yet
+    char **inputs;
+    size_t *inputLengths;
+
+    // whether each player's pipe has been closed
+    bool *closed;
+
+    // the player each fd last given to poll() for the game belongs to
+    int *polled;
+} Game;
+
+// the most fds a game asks poll() about: the player it waits on, and
+// every player with output waiting
+#define GAME_MAX_FDS(game) ((game)->path->playersInGame + 1)
 
 int start_dealer(Path *path, char *givenPath);
+Game *create_game(Path *path, char *givenPath);
+void free_game(Game *game);
+void advance_game(Game *game);
+void stop_game(Game *game, DealerErrorCode error);
+void end_game_early(Game *game);
+int game_poll_fds(Game *game, struct pollfd *fds);
+int game_timeout(Game *game);
+int sooner_timeout(int timeout, int other);
+void service_game(Game *game, struct pollfd *fds, int count);
+void run_games(Game **games, int count);
+bool setup_players(Path *path, int numPlayers);
+bool make_forks(int numPlayers, Path *path, char **argv);
 
 #endif
-
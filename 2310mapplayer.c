@@ -0,0 +1,32 @@
+#include "2310mapplayer.h"
+
+/** Player A or B built for one map by 2310pathgen. On any other map it
+ *  plays with the general strategy.
+ */
+int main(int argc, char **argv) {
+    check_player_args(argc, argv);
+
+    char *trash;
+    int numPlayers = (int) strtol(argv[1], &trash, 10);
+    int playerID = (int) strtol(argv[2], &trash, 10);
+
+    printf("^");
+    fflush(stdout);
+
+    // check path
+    char *givenPath = read_line(stdin);
+    check_map_file(givenPath, PLAYER);
+
+    Path *path = allocate_path(givenPath, numPlayers);
+    path->players = malloc(sizeof(Player *) * numPlayers);
+
+    for (int i = 0; i < numPlayers; ++i) {
+        path->players[i] = init_player(path, i);
+    }
+    arrange_order_of_players(path);
+    if (strcmp(givenPath, MAP_PATH) == 0) {
+        path->nextMove = map_next_move;
+    }
+
+    start_player(numPlayers, playerID, path, MAP_PLAYER_TYPE);
+}
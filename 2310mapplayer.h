@@ -0,0 +1,20 @@
+#ifndef MAP_PLAYER_H
+#define MAP_PLAYER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "util.h"
+#include "path.h"
+
+// whether the site has room for another player, given its capacity
+#define SITE_OPEN(path, site, limit) \
+        ((path)->sites[site].numPlayersCurrently < (limit))
+
+// the map and strategy the player was generated for by 2310pathgen
+extern const char MAP_PATH[];
+extern const char MAP_PLAYER_TYPE;
+int map_next_move(Path *path, int playerId);
+
+#endif
@@ -0,0 +1,57 @@
+#include "2310pathgen.h"
+
+/** Exits with the error code.
+ *
+ * @param errorCode The error code to exit with.
+ * @exit code 1 - Incorrect args, or a player which is not A or B
+ * @exit code 2 - Path can't be read or is invalid
+ * @exit code 3 - Output file can't be written
+ */
+void pathgen_exit(PathgenErrorCode errorCode) {
+    switch (errorCode) {
+        case INVALID_PATHGEN_ARGS:
+            fprintf(stderr, "Usage: 2310pathgen path A|B [output]");
+            break;
+        case INVALID_PATHGEN_PATH:
+            fprintf(stderr, "Error reading path");
+            break;
+        case INVALID_PATHGEN_OUTPUT:
+            fprintf(stderr, "Error writing output");
+            break;
+    }
+    fprintf(stderr, "\n");
+    fflush(stderr);
+    exit(errorCode);
+}
+
+/** Generates the C code of a player specialised to the given path, to be
+ *  built with 2310mapplayer.c and the player sources, eg
+ *  "make 2310mapplayer MAP=map.path TYPE=A", which makes
+ *  build/2310mapplayer-map.path-A.
+ */
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        pathgen_exit(INVALID_PATHGEN_ARGS);
+    }
+    char playerType = program_player_type(argv[2]);
+    if (playerType == 0) {
+        pathgen_exit(INVALID_PATHGEN_ARGS);
+    }
+
+    // with no players, sites which hold any number have a limit of 0
+    char *givenPath;
+    Path *path = load_path(argv[1], 0, &givenPath);
+    if (path == NULL) {
+        pathgen_exit(INVALID_PATHGEN_PATH);
+    }
+
+    FILE *out = argc == 4 ? fopen(argv[3], "w") : stdout;
+    if (out == NULL) {
+        pathgen_exit(INVALID_PATHGEN_OUTPUT);
+    }
+    write_map_player(out, path, givenPath, argv[1], playerType);
+    if (fclose(out) != 0) {
+        pathgen_exit(INVALID_PATHGEN_OUTPUT);
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef PATHGEN_PROGRAM_H
+#define PATHGEN_PROGRAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "util.h"
+#include "path.h"
+#include "compiled.h"
+#include "pathgen.h"
+
+/** All error codes 2310pathgen can exit with. **/
+typedef enum PathgenErrorCodes {
+    INVALID_PATHGEN_ARGS = 1,
+    INVALID_PATHGEN_PATH = 2,
+    INVALID_PATHGEN_OUTPUT = 3
+} PathgenErrorCode;
+
+#endif
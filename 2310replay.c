@@ -0,0 +1,159 @@
+#include "2310replay.h"
+
+/** Exits with the error code.
+ *
+ * @param errorCode The error code to exit with.
+ * @exit code 1 - Incorrect number of args
+ * @exit code 2 - Transcript can't be read or is invalid
+ */
+void replay_exit(ReplayErrorCode errorCode) {
+    switch (errorCode) {
+        case INVALID_REPLAY_ARGS:
+            fprintf(stderr, "Usage: 2310replay transcript");
+            break;
+        case INVALID_TRANSCRIPT:
+            fprintf(stderr, "Error reading transcript");
+            break;
+    }
+    fprintf(stderr, "\n");
+    fflush(stderr);
+    fflush(stdout);
+    exit(errorCode);
+}
+
+/** Reads a varint, exiting if the transcript ends first.
+ *
+ * @param file The transcript
+ * @return The value read
+ */
+uint64_t expect_varint(FILE *file) {
+    uint64_t value;
+    if (!read_varint(file, &value)) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    return value;
+}
+
+/** Reads the seed:... spec of a generated deck from the header.
+ *
+ * @param file The transcript
+ * @return The spec, or NULL if the deck was read from a file
+ */
+char *read_seed(FILE *file) {
+    uint64_t seedLength = expect_varint(file);
+    if (seedLength == 0) {
+        return NULL;
+    }
+    if (seedLength > INT_MAX) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    char *seed = malloc(seedLength + 1);
+    if (fread(seed, 1, seedLength, file) != seedLength) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    seed[seedLength] = '\0';
+    SeedSpec parsed;
+    if (!parse_seed_spec(seed, &parsed)) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    return seed;
+}
+
+/** Reads the transcript header and sets up the path it describes.
+ *
+ * @param file The transcript
+ * @param seed Set to the deck's seed:... spec, or NULL if the deck was read
+ * from a file
+ * @return The game path, with every player at the start
+ */
+Path *read_header(FILE *file, char **seed) {
+    char magic[sizeof(TRANSCRIPT_MAGIC)];
+    if (fread(magic, 1, strlen(TRANSCRIPT_MAGIC), file) !=
+            strlen(TRANSCRIPT_MAGIC) ||
+            memcmp(magic, TRANSCRIPT_MAGIC, strlen(TRANSCRIPT_MAGIC)) != 0) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    uint64_t version = expect_varint(file);
+    if (version < 1 || version > TRANSCRIPT_VERSION) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+
+    uint64_t numPlayers = expect_varint(file);
+    uint64_t pathLength = expect_varint(file);
+    if (numPlayers < 1 || numPlayers > MAX_PLAYERS || pathLength > INT_MAX) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    char *givenPath = malloc(pathLength + 1);
+    if (fread(givenPath, 1, pathLength, file) != pathLength) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    givenPath[pathLength] = '\0';
+    if (!map_file_valid(givenPath)) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+
+    // the deck hash is only for matching transcripts to decks
+    char deckHash[8];
+    if (fread(deckHash, 1, sizeof(deckHash), file) != sizeof(deckHash)) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+    *seed = version >= 2 ? read_seed(file) : NULL;
+
+    Path *path = allocate_path(givenPath, numPlayers);
+    path->players = malloc(sizeof(Player *) * numPlayers);
+    for (int i = 0; i < numPlayers; ++i) {
+        path->players[i] = init_player(path, i);
+    }
+    arrange_order_of_players(path);
+
+    return path;
+}
+
+/** Prints the dealer's output for a transcript written by the dealer with
+ *  DEALER_TRANSCRIPT set.
+ */
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        replay_exit(INVALID_REPLAY_ARGS);
+    }
+    FILE *file = fopen(argv[1], "r");
+    if (file == NULL) {
+        replay_exit(INVALID_TRANSCRIPT);
+    }
+
+    char *seed;
+    Path *path = read_header(file, &seed);
+    // as the dealer prints it before the board
+    if (seed != NULL) {
+        printf("Deck %s\n", seed);
+    }
+    print_path(path, stdout);
+
+    while (true) {
+        uint64_t playerTag = expect_varint(file);
+        if (playerTag == 0) {
+            break;
+        }
+        int playerId = (int) playerTag - 1;
+        if (playerTag > path->playersInGame) {
+            replay_exit(INVALID_TRANSCRIPT);
+        }
+
+        Player *player = path->players[playerId];
+        int steps = unzigzag(expect_varint(file));
+        int points = unzigzag(expect_varint(file));
+        int money = unzigzag(expect_varint(file));
+        uint64_t card = expect_varint(file);
+        int siteId = player->siteNumber + steps;
+        if (siteId < 0 || siteId >= path->size || card > NUM_CARDS) {
+            replay_exit(INVALID_TRANSCRIPT);
+        }
+
+        apply_hap(path, playerId, siteId, points, money, (int) card);
+        print_player_details(path, playerId, stdout);
+        fflush(stdout);
+    }
+
+    game_over(path, stdout);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "util.h"
+#include "path.h"
+#include "transcript.h"
+
+/** All error codes 2310replay can exit with. **/
+typedef enum ReplayErrorCodes {
+    INVALID_REPLAY_ARGS = 1,
+    INVALID_TRANSCRIPT = 2
+} ReplayErrorCode;
+
+#endif
@@ -0,0 +1,106 @@
+#include "2310solve.h"
+
+/** Exits with the error code.
+ *
+ * @param errorCode The error code to exit with.
+ * @exit code 1 - Incorrect number of args
+ * @exit code 2 - Deck can't be read or is invalid
+ * @exit code 3 - Path can't be read or is invalid
+ * @exit code 4 - A player is not A or B
+ */
+void solve_exit(SolveErrorCode errorCode) {
+    switch (errorCode) {
+        case INVALID_SOLVE_ARGS:
+            fprintf(stderr, "Usage: 2310solve deck path p1 {p2}");
+            break;
+        case INVALID_SOLVE_DECK:
+            fprintf(stderr, "Error reading deck");
+            break;
+        case INVALID_SOLVE_PATH:
+            fprintf(stderr, "Error reading path");
+            break;
+        case INVALID_SOLVE_PLAYER:
+            fprintf(stderr, "Invalid player");
+            break;
+    }
+    fprintf(stderr, "\n");
+    fflush(stderr);
+    fflush(stdout);
+    exit(errorCode);
+}
+
+/** Returns the number of threads to search with: SOLVE_THREADS_ENV if
+ *  set, otherwise one per CPU.
+ */
+int solve_threads(void) {
+    char *threads = getenv(SOLVE_THREADS_ENV);
+    long numThreads = threads != NULL ? strtol(threads, NULL, 10) :
+            sysconf(_SC_NPROCESSORS_ONLN);
+    return numThreads < 1 ? 1 : (int) numThreads;
+}
+
+/** Returns the bytes the transposition table may use: SOLVE_TABLE_ENV
+ *  megabytes if set, otherwise DEFAULT_TABLE_MB.
+ */
+size_t solve_table_bytes(void) {
+    char *megabytes = getenv(SOLVE_TABLE_ENV);
+    long tableMegabytes = megabytes != NULL ?
+            strtol(megabytes, NULL, 10) : DEFAULT_TABLE_MB;
+    return (size_t) (tableMegabytes < 1 ? 1 : tableMegabytes) << 20;
+}
+
+/** Finds the best score each seat could get against the others' fixed
+ *  strategies, given the dealer's arguments with A and B for the players,
+ *  and prints it beside what the seat's own strategy scores.
+ */
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 3 + MAX_PLAYERS) {
+        solve_exit(INVALID_SOLVE_ARGS);
+    }
+    int numPlayers = argc - 3;
+    bool playsB[numPlayers];
+    for (int i = 0; i < numPlayers; ++i) {
+        char playerType = program_player_type(argv[i + 3]);
+        if (playerType == 0) {
+            solve_exit(INVALID_SOLVE_PLAYER);
+        }
+        playsB[i] = playerType == 'B';
+    }
+
+    Deck *deck = load_deck(argv[1]);
+    if (deck == NULL) {
+        solve_exit(INVALID_SOLVE_DECK);
+    }
+    int numCards = deck->count;
+    char *cards = take_cards(deck);
+    char *givenPath;
+    Path *path = load_path(argv[2], numPlayers, &givenPath);
+    if (path == NULL) {
+        solve_exit(INVALID_SOLVE_PATH);
+    }
+    free_path(path);
+
+    Solver *solver = create_solver(givenPath, numPlayers, playsB, cards,
+            numCards, solve_table_bytes());
+    int numThreads = solve_threads();
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    solve_game(solver, numThreads);
+    double seconds = elapsed_nanos(&started) / 1e9;
+
+    int line[solver->size];
+    for (int seat = 0; seat < numPlayers; ++seat) {
+        printf("Seat %d (%c) scores %d, best %d:", seat,
+                playsB[seat] ? 'B' : 'A', strategy_score(solver, seat),
+                best_score(solver, seat));
+        int length = best_line(solver, seat, line);
+        for (int move = 0; move < length; ++move) {
+            printf(" DO%d", line[move]);
+        }
+        printf("\n");
+    }
+    printf("Nodes: %llu in %.3fs on %d threads, %.0f per second\n",
+            (unsigned long long) solver->nodes, seconds, numThreads,
+            seconds > 0 ? solver->nodes / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef SOLVE_PROGRAM_H
+#define SOLVE_PROGRAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "util.h"
+#include "path.h"
+#include "deck.h"
+#include "compiled.h"
+#include "solve.h"
+
+/** All error codes 2310solve can exit with. **/
+typedef enum SolveErrorCodes {
+    INVALID_SOLVE_ARGS = 1,
+    INVALID_SOLVE_DECK = 2,
+    INVALID_SOLVE_PATH = 3,
+    INVALID_SOLVE_PLAYER = 4
+} SolveErrorCode;
+
+#endif
@@ -0,0 +1,52 @@
+#include "2310standin.h"
+
+/** Returns the settings for the player: STANDIN_<id> if set, otherwise
+ *  STANDIN_ENV, otherwise none.
+ *
+ * @param playerId The player's ID
+ * @return The settings
+ */
+char *standin_settings(int playerId) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s_%d", STANDIN_ENV, playerId);
+    char *settings = getenv(name);
+    if (settings == NULL) {
+        settings = getenv(STANDIN_ENV);
+    }
+    return settings != NULL ? settings : "";
+}
+
+/** A player for load testing the dealer, which plays like Player A or B
+ *  but can be made slow or badly behaved. See parse_standin for the
+ *  settings.
+ */
+int main(int argc, char **argv) {
+    check_player_args(argc, argv);
+
+    char *trash;
+    int numPlayers = (int) strtol(argv[1], &trash, 10);
+    int playerID = (int) strtol(argv[2], &trash, 10);
+
+    Standin *standin = parse_standin(standin_settings(playerID), playerID);
+    if (standin == NULL) {
+        fprintf(stderr, "Invalid stand-in settings\n");
+        exit(INVALID_STANDIN_SETTINGS);
+    }
+
+    printf("^");
+    fflush(stdout);
+
+    // check path
+    char *givenPath = read_line(stdin);
+    check_map_file(givenPath, PLAYER);
+
+    Path *path = allocate_path(givenPath, numPlayers);
+    path->players = malloc(sizeof(Player *) * numPlayers);
+
+    for (int i = 0; i < numPlayers; ++i) {
+        path->players[i] = init_player(path, i);
+    }
+    arrange_order_of_players(path);
+
+    run_standin(standin, path, playerID);
+}
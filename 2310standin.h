@@ -0,0 +1,17 @@
+#ifndef STANDIN_PROGRAM_H
+#define STANDIN_PROGRAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "util.h"
+#include "path.h"
+#include "standin.h"
+
+/** The error code 2310standin exits with besides those players use. **/
+typedef enum StandinErrorCodes {
+    INVALID_STANDIN_SETTINGS = 7
+} StandinErrorCode;
+
+#endif
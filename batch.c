@@ -0,0 +1,338 @@
+#include "batch.h"
+
+/** Makes an empty batch.
+ *
+ * @param lanes The most games to advance together
+ * @return The batch
+ */
+Batch *create_batch(int lanes) {
+    Batch *batch = malloc(sizeof(Batch));
+    batch->lanes = lanes;
+    batch->active = 0;
+    batch->games = malloc(sizeof(BatchGame *) * lanes);
+
+    // every vector operation covers BATCH_WIDTH lanes, used or not
+    int padded = (lanes + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+    int32_t **fields[] = {&batch->fields.mover, &batch->fields.playsB,
+            &batch->fields.money, &batch->fields.countV1,
+            &batch->fields.countV2, &batch->fields.points,
+            &batch->fields.doSteps, &batch->fields.moSteps,
+            &batch->fields.riSteps, &batch->fields.v2Steps,
+            &batch->fields.stopSteps, &batch->fields.earliestSteps,
+            &batch->fields.nextOpen, &batch->fields.nextMo,
+            &batch->fields.lastPlayer, &batch->fields.wantsCard,
+            &batch->fields.steps, &batch->fields.kind,
+            &batch->fields.drawn, &batch->fields.numCards,
+            &batch->fields.cardDrawn};
+    for (size_t field = 0; field < sizeof(fields) / sizeof(fields[0]);
+            ++field) {
+        *fields[field] = calloc(padded, sizeof(int32_t));
+    }
+    return batch;
+}
+
+/** Puts a game in the next free lane.
+ *
+ * @param batch The batch
+ * @param game The game, with its players at the start
+ * @return false if every lane is in use
+ */
+bool batch_add(Batch *batch, BatchGame *game) {
+    if (batch->active == batch->lanes) {
+        return false;
+    }
+    batch->games[batch->active] = game;
+    batch->active += 1;
+    return true;
+}
+
+/** Returns how many steps it is to the first open site of the given kinds
+ *  in (site, to), the way check_before_barrier counts them.
+ *
+ * @param path The game path
+ * @param kinds The KIND_BIT()s of the site kinds to look for
+ * @param site The site the player is on
+ * @param to One past the last site to look at
+ * @return The number of steps, or -1 if there is no such site
+ */
+static int32_t steps_to(Path *path, unsigned int kinds, int site, int to) {
+    int siteID = find_site(path, kinds, true, site + 1, to);
+    return siteID == -1 ? -1 : siteID - site;
+}
+
+/** Loads the lane's next player and everything their strategy looks at
+ *  into the lane. Both strategies' views are loaded, whichever the player
+ *  uses, so that choosing the move does not branch.
+ *
+ * @param batch The batch
+ * @param lane The lane
+ */
+static void gather_lane(Batch *batch, int lane) {
+    BatchGame *game = batch->games[lane];
+    BatchLanes *fields = &batch->fields;
+    Path *path = game->path;
+    int moverId = next_player_to_move(path);
+    Player *player = path->players[moverId];
+    int site = player->siteNumber;
+    int barrier = find_next_barrier(path, site);
+    Site *nextSite = &path->sites[site + 1];
+
+    fields->mover[lane] = moverId;
+    fields->playsB[lane] = game->playsB[moverId];
+    fields->money[lane] = player->money;
+    fields->countV1[lane] = player->countV1;
+    fields->countV2[lane] = player->countV2;
+    fields->points[lane] = player->points;
+
+    fields->doSteps[lane] = steps_to(path, KIND_BIT(SITE_DO), site, barrier);
+    fields->moSteps[lane] = steps_to(path, KIND_BIT(SITE_MO), site, barrier);
+    fields->riSteps[lane] = steps_to(path, KIND_BIT(SITE_RI), site, barrier);
+    fields->v2Steps[lane] = steps_to(path, KIND_BIT(SITE_V2), site, barrier);
+    fields->stopSteps[lane] = steps_to(path, KIND_BIT(SITE_V1) |
+            KIND_BIT(SITE_V2) | KIND_BIT(SITE_BARRIER), site, barrier + 1);
+    fields->earliestSteps[lane] = find_earliest(path, site) - site;
+    fields->nextOpen[lane] = available(*nextSite) == 0;
+    fields->nextMo[lane] = nextSite->kind == SITE_MO;
+    fields->lastPlayer[lane] = check_if_last_player(path, player) == 0;
+    fields->wantsCard[lane] = check_if_most_cards(path, player) == 0 ||
+            check_empty_cards(path) == 0;
+
+    fields->drawn[lane] = game->drawn;
+    fields->numCards[lane] = game->numCards;
+}
+
+#ifdef __SSE2__
+/** Returns a where mask is set and b elsewhere. **/
+static inline __m128i select_lanes(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/** Loads BATCH_WIDTH lanes of a field. **/
+static inline __m128i load_lanes(const int32_t *field, int from) {
+    return _mm_loadu_si128((const __m128i *) &field[from]);
+}
+
+/** Stores BATCH_WIDTH lanes of a field. **/
+static inline void store_lanes(int32_t *field, int from, __m128i value) {
+    _mm_storeu_si128((__m128i *) &field[from], value);
+}
+
+/** Chooses the move of BATCH_WIDTH lanes' players with the rules of
+ *  player_a_next_move and player_b_next_move. Each rule is applied to
+ *  every lane, from the last to the first, so that a rule which holds
+ *  replaces the moves of the rules after it.
+ *
+ * @param fields The lanes
+ * @param from The first of the lanes
+ */
+static void choose_steps(BatchLanes *fields, int from) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi32(1);
+    __m128i none = _mm_set1_epi32(-1);
+    __m128i money = load_lanes(fields->money, from);
+    __m128i nextOpen = _mm_cmpgt_epi32(load_lanes(fields->nextOpen, from),
+            zero);
+    __m128i doSteps = load_lanes(fields->doSteps, from);
+    __m128i moSteps = load_lanes(fields->moSteps, from);
+    __m128i riSteps = load_lanes(fields->riSteps, from);
+    __m128i v2Steps = load_lanes(fields->v2Steps, from);
+
+    // Player A
+    __m128i stepsA = load_lanes(fields->stopSteps, from);
+    __m128i toMo = _mm_and_si128(nextOpen, _mm_cmpgt_epi32(
+            load_lanes(fields->nextMo, from), zero));
+    stepsA = select_lanes(toMo, one, stepsA);
+    __m128i toDo = _mm_andnot_si128(_mm_cmpeq_epi32(doSteps, none),
+            _mm_cmpgt_epi32(money, zero));
+    stepsA = select_lanes(toDo, doSteps, stepsA);
+
+    // Player B
+    __m128i stepsB = load_lanes(fields->earliestSteps, from);
+    stepsB = select_lanes(_mm_cmpeq_epi32(v2Steps, none), stepsB, v2Steps);
+    __m128i toRi = _mm_andnot_si128(_mm_cmpeq_epi32(riSteps, none),
+            _mm_cmpgt_epi32(load_lanes(fields->wantsCard, from), zero));
+    stepsB = select_lanes(toRi, riSteps, stepsB);
+    __m128i toMoney = _mm_andnot_si128(_mm_cmpeq_epi32(moSteps, none),
+            _mm_cmpeq_epi32(_mm_and_si128(money, one), one));
+    stepsB = select_lanes(toMoney, moSteps, stepsB);
+    __m128i toNext = _mm_and_si128(nextOpen, _mm_cmpgt_epi32(
+            load_lanes(fields->lastPlayer, from), zero));
+    stepsB = select_lanes(toNext, one, stepsB);
+
+    __m128i playsB = _mm_cmpgt_epi32(load_lanes(fields->playsB, from), zero);
+    store_lanes(fields->steps, from, select_lanes(playsB, stepsB, stepsA));
+}
+
+/** Does what do_action does for the site each of BATCH_WIDTH lanes'
+ *  players landed on, and draws a card for those who landed on a Ri.
+ *
+ * @param fields The lanes, with kind set to the kind of site landed on
+ * @param from The first of the lanes
+ */
+static void apply_action(BatchLanes *fields, int from) {
+    __m128i kind = load_lanes(fields->kind, from);
+    __m128i money = load_lanes(fields->money, from);
+    __m128i points = load_lanes(fields->points, from);
+    __m128i drawn = load_lanes(fields->drawn, from);
+    __m128i isMo = _mm_cmpeq_epi32(kind, _mm_set1_epi32(SITE_MO));
+    __m128i isV1 = _mm_cmpeq_epi32(kind, _mm_set1_epi32(SITE_V1));
+    __m128i isV2 = _mm_cmpeq_epi32(kind, _mm_set1_epi32(SITE_V2));
+    __m128i isDo = _mm_cmpeq_epi32(kind, _mm_set1_epi32(SITE_DO));
+    __m128i isRi = _mm_cmpeq_epi32(kind, _mm_set1_epi32(SITE_RI));
+
+    money = _mm_add_epi32(money, _mm_and_si128(isMo, _mm_set1_epi32(3)));
+    // a set mask is -1, so subtracting it counts the visit
+    store_lanes(fields->countV1, from, _mm_sub_epi32(
+            load_lanes(fields->countV1, from), isV1));
+    store_lanes(fields->countV2, from, _mm_sub_epi32(
+            load_lanes(fields->countV2, from), isV2));
+    // every 2 money becomes a point; money is never negative
+    points = _mm_add_epi32(points, _mm_and_si128(isDo,
+            _mm_srai_epi32(money, 1)));
+    money = _mm_andnot_si128(isDo, money);
+    store_lanes(fields->money, from, money);
+    store_lanes(fields->points, from, points);
+
+    // the deck goes round once every card has been drawn
+    store_lanes(fields->cardDrawn, from, select_lanes(isRi, drawn,
+            _mm_set1_epi32(-1)));
+    __m128i next = _mm_add_epi32(drawn, _mm_set1_epi32(1));
+    next = _mm_andnot_si128(_mm_cmpeq_epi32(next,
+            load_lanes(fields->numCards, from)), next);
+    store_lanes(fields->drawn, from, select_lanes(isRi, next, drawn));
+}
+#else
+/** Chooses the move of BATCH_WIDTH lanes' players with the rules of
+ *  player_a_next_move and player_b_next_move.
+ *
+ * @param fields The lanes
+ * @param from The first of the lanes
+ */
+static void choose_steps(BatchLanes *fields, int from) {
+    for (int lane = from; lane < from + BATCH_WIDTH; ++lane) {
+        int32_t steps;
+        if (!fields->playsB[lane]) {
+            if (fields->money[lane] > 0 && fields->doSteps[lane] != -1) {
+                steps = fields->doSteps[lane];
+            } else if (fields->nextMo[lane] && fields->nextOpen[lane]) {
+                steps = 1;
+            } else {
+                steps = fields->stopSteps[lane];
+            }
+        } else if (fields->nextOpen[lane] && fields->lastPlayer[lane]) {
+            steps = 1;
+        } else if (fields->money[lane] % 2 == 1 &&
+                fields->moSteps[lane] != -1) {
+            steps = fields->moSteps[lane];
+        } else if (fields->wantsCard[lane] && fields->riSteps[lane] != -1) {
+            steps = fields->riSteps[lane];
+        } else if (fields->v2Steps[lane] != -1) {
+            steps = fields->v2Steps[lane];
+        } else {
+            steps = fields->earliestSteps[lane];
+        }
+        fields->steps[lane] = steps;
+    }
+}
+
+/** Does what do_action does for the site each of BATCH_WIDTH lanes'
+ *  players landed on, and draws a card for those who landed on a Ri.
+ *
+ * @param fields The lanes, with kind set to the kind of site landed on
+ * @param from The first of the lanes
+ */
+static void apply_action(BatchLanes *fields, int from) {
+    for (int lane = from; lane < from + BATCH_WIDTH; ++lane) {
+        int32_t kind = fields->kind[lane];
+        fields->money[lane] += kind == SITE_MO ? 3 : 0;
+        fields->countV1[lane] += kind == SITE_V1;
+        fields->countV2[lane] += kind == SITE_V2;
+        if (kind == SITE_DO) {
+            fields->points[lane] += fields->money[lane] / 2;
+            fields->money[lane] = 0;
+        }
+
+        fields->cardDrawn[lane] = -1;
+        if (kind == SITE_RI) {
+            fields->cardDrawn[lane] = fields->drawn[lane];
+            fields->drawn[lane] += 1;
+            if (fields->drawn[lane] == fields->numCards[lane]) {
+                fields->drawn[lane] = 0;
+            }
+        }
+    }
+}
+#endif
+
+/** Takes the finished games out of the batch, moving the last game in play
+ *  into each lane freed.
+ *
+ * @param batch The batch
+ * @param finished Filled with the finished games
+ * @return The number of finished games
+ */
+static int retire_finished(Batch *batch, BatchGame **finished) {
+    int numFinished = 0;
+    int lane = 0;
+    while (lane < batch->active) {
+        if (check_game_over(batch->games[lane]->path) == 0) {
+            finished[numFinished] = batch->games[lane];
+            numFinished += 1;
+            batch->active -= 1;
+            batch->games[lane] = batch->games[batch->active];
+        } else {
+            lane += 1;
+        }
+    }
+    return numFinished;
+}
+
+/** Takes out the finished games, then plays a turn of every other game.
+ *
+ * @param batch The batch
+ * @param finished Filled with the games which had finished, in no order;
+ * room for every lane is needed
+ * @return The number of finished games
+ */
+int batch_step(Batch *batch, BatchGame **finished) {
+    BatchLanes *fields = &batch->fields;
+    int numFinished = retire_finished(batch, finished);
+
+    for (int lane = 0; lane < batch->active; ++lane) {
+        gather_lane(batch, lane);
+    }
+    for (int lane = 0; lane < batch->active; lane += BATCH_WIDTH) {
+        choose_steps(fields, lane);
+    }
+
+    // occupancy is kept per game, so moving is done a lane at a time
+    for (int lane = 0; lane < batch->active; ++lane) {
+        Path *path = batch->games[lane]->path;
+        Player *player = path->players[fields->mover[lane]];
+        move_player(path, player->id, fields->steps[lane], PLAYER);
+        fields->kind[lane] = path->sites[player->siteNumber].kind;
+    }
+    for (int lane = 0; lane < batch->active; lane += BATCH_WIDTH) {
+        apply_action(fields, lane);
+    }
+
+    for (int lane = 0; lane < batch->active; ++lane) {
+        BatchGame *game = batch->games[lane];
+        Player *player = game->path->players[fields->mover[lane]];
+        player->money = fields->money[lane];
+        player->countV1 = fields->countV1[lane];
+        player->countV2 = fields->countV2[lane];
+        player->points = fields->points[lane];
+        game->drawn = fields->drawn[lane];
+
+        // as do_ri, anything but A to E draws nothing
+        if (fields->cardDrawn[lane] != -1) {
+            char value = game->cards[fields->cardDrawn[lane]];
+            if (value >= 'A' && value <= 'E') {
+                give_card(game->path, player, value - 'A');
+            }
+        }
+    }
+
+    return numFinished;
+}
@@ -0,0 +1,85 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "path.h"
+
+// games advanced together by one vector operation
+#define BATCH_WIDTH 4
+
+/** A game being simulated in a batch, without player processes. **/
+typedef struct BatchGame {
+    // where the game came in the input
+    int index;
+
+    Path *path;
+
+    // true for the seats playing as Player B, false for Player A
+    bool *playsB;
+
+    // the deck in draw order, and how many cards have been drawn since it
+    // last went round. Generated decks are the game's own; decks read from
+    // a file are shared with every game using the file.
+    const char *cards;
+    bool ownsCards;
+    int numCards;
+    int drawn;
+} BatchGame;
+
+/** The state of each lane's moving player, one array per field so that
+ *  BATCH_WIDTH lanes can be loaded into a vector at once.
+ */
+typedef struct BatchLanes {
+    int32_t *mover;
+    int32_t *playsB;
+    int32_t *money;
+    int32_t *countV1;
+    int32_t *countV2;
+    int32_t *points;
+
+    // what the player's strategy can see from where they are; steps are -1
+    // where there is no such open site before the next barrier
+    int32_t *doSteps;
+    int32_t *moSteps;
+    int32_t *riSteps;
+    int32_t *v2Steps;
+    int32_t *stopSteps;
+    int32_t *earliestSteps;
+    int32_t *nextOpen;
+    int32_t *nextMo;
+    int32_t *lastPlayer;
+    int32_t *wantsCard;
+
+    // the move chosen, then the kind of site it landed on
+    int32_t *steps;
+    int32_t *kind;
+
+    // the deck of the lane's game, and which card a Ri landing drew or -1
+    int32_t *drawn;
+    int32_t *numCards;
+    int32_t *cardDrawn;
+} BatchLanes;
+
+/** Games advanced in lockstep, a turn of every game at a time. Games in
+ *  play are kept in lanes [0, active) so no lanes are wasted on finished
+ *  games.
+ */
+typedef struct Batch {
+    int lanes;
+    int active;
+    BatchGame **games;
+    BatchLanes fields;
+} Batch;
+
+Batch *create_batch(int lanes);
+bool batch_add(Batch *batch, BatchGame *game);
+int batch_step(Batch *batch, BatchGame **finished);
+
+#endif
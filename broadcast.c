@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+#include "broadcast.h"
+#include "path.h"
+#include "metrics.h"
+
+/** Makes the broadcast staging pipe and the players' output queues. The
+ *  staging pipe is closed on exec, so players never hold either end of it.
+ *
+ * @param numPlayers The number of players
+ * @return The broadcast, which falls back to plain writes if tee/splice
+ * cannot be used.
+ */
+Broadcast *create_broadcast(int numPlayers) {
+    Broadcast *broadcast = malloc(sizeof(Broadcast));
+    broadcast->spliceable = false;
+#ifdef __linux__
+    if (pipe2(broadcast->stage, O_CLOEXEC) == 0) {
+        broadcast->spliceable = true;
+    }
+#endif
+    broadcast->queued = calloc(numPlayers, sizeof(char *));
+    broadcast->queuedLengths = calloc(numPlayers, sizeof(size_t));
+    broadcast->numPlayers = numPlayers;
+    broadcast->failed = false;
+    return broadcast;
+}
+
+/** Closes the staging pipe and frees whatever was never sent.
+ *
+ * @param broadcast The broadcast
+ */
+void free_broadcast(Broadcast *broadcast) {
+    if (broadcast->spliceable) {
+        close(broadcast->stage[READ_END]);
+        close(broadcast->stage[WRITE_END]);
+    }
+    for (int playerId = 0; playerId < broadcast->numPlayers; ++playerId) {
+        free(broadcast->queued[playerId]);
+    }
+    free(broadcast->queued);
+    free(broadcast->queuedLengths);
+    free(broadcast);
+}
+
+/** Writes all of the message to the fd.
+ *
+ * @param fd The fd to write to
+ * @param message The bytes to write
+ * @param length The number of bytes to write
+ */
+void write_all(int fd, const char *message, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, message, length);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        message += written;
+        length -= written;
+    }
+}
+
+/** Writes as much of the bytes to a player's pipe as it has room for. If
+ *  the player has closed its end, the broadcast is marked failed and the
+ *  bytes are taken as written, as they can never be sent.
+ *
+ * @param broadcast The broadcast
+ * @param fd The player's pipe
+ * @param bytes The bytes to write
+ * @param length The number of bytes to write
+ * @return How many of the bytes are done with
+ */
+static size_t write_some(Broadcast *broadcast, int fd, const char *bytes,
+        size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t got = write(fd, &bytes[written], length - written);
+        if (got > 0) {
+            written += got;
+        } else if (got == -1 && errno == EINTR) {
+            continue;
+        } else if (got == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            broadcast->failed = true;
+            return length;
+        } else {
+            break;
+        }
+    }
+    return written;
+}
+
+/** Adds bytes after whatever the player is still to be sent.
+ *
+ * @param broadcast The broadcast
+ * @param playerId The player
+ * @param bytes The bytes to add
+ * @param length The number of bytes
+ */
+static void queue_output(Broadcast *broadcast, int playerId,
+        const char *bytes, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    size_t queued = broadcast->queuedLengths[playerId];
+    broadcast->queued[playerId] = realloc(broadcast->queued[playerId],
+            queued + length);
+    memcpy(&broadcast->queued[playerId][queued], bytes, length);
+    broadcast->queuedLengths[playerId] = queued + length;
+}
+
+/** Sends a line to one player, queueing whatever its pipe has no room for.
+ *
+ * @param path The game path
+ * @param playerId The player
+ * @param line The formatted line, including its newline
+ * @param length The length of the line
+ */
+void send_line(Path *path, int playerId, const char *line, size_t length) {
+    Broadcast *broadcast = path->broadcast;
+    count_bytes(CHANNEL_PLAYERS, length);
+
+    // nothing may overtake what is already queued
+    size_t written = 0;
+    if (broadcast->queuedLengths[playerId] == 0) {
+        written = write_some(broadcast, TO_PLAYER(path->players[playerId]),
+                line, length);
+    }
+    queue_output(broadcast, playerId, &line[written], length - written);
+}
+
+/** Returns whether the player has output waiting for room in its pipe.
+ *
+ * @param path The game path
+ * @param playerId The player
+ * @return true if there is queued output
+ */
+bool output_waiting(Path *path, int playerId) {
+    return path->broadcast->queuedLengths[playerId] > 0;
+}
+
+/** Sends as much of the player's queued output as its pipe will take.
+ *
+ * @param path The game path
+ * @param playerId The player
+ */
+void flush_output(Path *path, int playerId) {
+    Broadcast *broadcast = path->broadcast;
+    size_t length = broadcast->queuedLengths[playerId];
+    size_t written = write_some(broadcast,
+            TO_PLAYER(path->players[playerId]), broadcast->queued[playerId],
+            length);
+    broadcast->queuedLengths[playerId] = length - written;
+    memmove(broadcast->queued[playerId],
+            &broadcast->queued[playerId][written], length - written);
+}
+
+/** Sends the line to every player. The line is written into the staging
+ *  pipe once, tee'd into every player's pipe but the last and spliced into
+ *  the last, so the dealer makes one copy however many players there are.
+ *  Players which are still waiting on earlier output, or whose pipes are
+ *  full, have the line queued instead.
+ *
+ * @param path The game path
+ * @param line The formatted line, including its newline
+ * @param length The length of the line
+ */
+void broadcast_line(Path *path, const char *line, size_t length) {
+    Broadcast *broadcast = path->broadcast;
+    int numPlayers = path->playersInGame;
+
+    if (!broadcast->spliceable || length > BROADCAST_MAX) {
+        for (int playerId = 0; playerId < numPlayers; ++playerId) {
+            send_line(path, playerId, line, length);
+        }
+        return;
+    }
+    count_bytes(CHANNEL_PLAYERS, length * numPlayers);
+
+#ifdef __linux__
+    // the last player the line can go straight to takes it from the stage
+    int last = -1;
+    for (int playerId = 0; playerId < numPlayers; ++playerId) {
+        if (broadcast->queuedLengths[playerId] == 0) {
+            last = playerId;
+        }
+    }
+    if (last == -1) {
+        for (int playerId = 0; playerId < numPlayers; ++playerId) {
+            queue_output(broadcast, playerId, line, length);
+        }
+        return;
+    }
+    write_all(broadcast->stage[WRITE_END], line, length);
+
+    size_t staged = length;
+    for (int playerId = 0; playerId < numPlayers; ++playerId) {
+        if (broadcast->queuedLengths[playerId] != 0) {
+            queue_output(broadcast, playerId, line, length);
+            continue;
+        }
+        int fd = TO_PLAYER(path->players[playerId]);
+        ssize_t copied;
+        if (playerId < last) {
+            copied = tee(broadcast->stage[READ_END], fd, length,
+                    SPLICE_F_NONBLOCK);
+        } else {
+            copied = splice(broadcast->stage[READ_END], NULL, fd, NULL,
+                    length, SPLICE_F_NONBLOCK);
+            staged -= copied > 0 ? copied : 0;
+        }
+        if (copied == -1 && errno == EPIPE) {
+            broadcast->failed = true;
+            continue;
+        }
+        if (copied < 0) {
+            copied = 0;
+        }
+
+        // the player's pipe was too full to take it all
+        queue_output(broadcast, playerId, &line[copied], length - copied);
+    }
+
+    // drop whatever the last player did not take from the stage
+    char discard[BROADCAST_MAX];
+    while (staged > 0) {
+        ssize_t drained = read(broadcast->stage[READ_END], discard, staged);
+        if (drained > 0) {
+            staged -= drained;
+        } else if (drained == 0 || errno != EINTR) {
+            break;
+        }
+    }
+#endif
+}
@@ -0,0 +1,51 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+
+// the longest line broadcast_line() will stage; HAPs are far shorter
+#define BROADCAST_MAX 4096
+
+// the dealer's end of the pipe it writes to a player through
+#define TO_PLAYER(player) ((player)->receivePipes[WRITE_END])
+
+struct Path;
+
+/** A pipe which a line is written to once and then copied into each
+ *  player's pipe without passing through the dealer again. The players'
+ *  pipes never block the dealer: whatever a pipe has no room for is kept
+ *  until poll() says it has room.
+ */
+typedef struct Broadcast {
+    // the staging pipe
+    int stage[2];
+
+    // false if tee/splice are unavailable, so lines are written to each
+    // player in turn
+    bool spliceable;
+
+    // bytes each player is still to be sent, oldest first
+    char **queued;
+    size_t *queuedLengths;
+    int numPlayers;
+
+    // set once a player's pipe has been found closed
+    bool failed;
+} Broadcast;
+
+Broadcast *create_broadcast(int numPlayers);
+void free_broadcast(Broadcast *broadcast);
+void send_line(struct Path *path, int playerId, const char *line,
+        size_t length);
+void broadcast_line(struct Path *path, const char *line, size_t length);
+bool output_waiting(struct Path *path, int playerId);
+void flush_output(struct Path *path, int playerId);
+
+#endif
@@ -0,0 +1,379 @@
+#include "compiled.h"
+#include "path.h"
+#include "deck.h"
+
+/** Returns the name of the compiled file kept for a source file.
+ *
+ * @param fileName The source file
+ * @param suffix PATH_CACHE_SUFFIX or DECK_CACHE_SUFFIX
+ * @return The compiled file's name
+ */
+static char *compiled_name(const char *fileName, const char *suffix) {
+    char *name = malloc(strlen(fileName) + strlen(suffix) + 1);
+    strcpy(name, fileName);
+    strcat(name, suffix);
+    return name;
+}
+
+/** Returns the size of a compiled file, going by its header.
+ *
+ * @param header The start of the compiled file
+ * @return The number of bytes in the whole file
+ */
+static size_t compiled_size(const CompiledHeader *header) {
+    if (header->kind == COMPILED_PATH) {
+        return sizeof(CompiledHeader) + sizeof(CompiledSite) *
+                (size_t) header->count + header->lineLength + 1;
+    }
+    return sizeof(CompiledHeader) + header->count;
+}
+
+/** Checks every site of a compiled path the way the path file's sites are
+ *  checked, so a damaged cache is never trusted.
+ *
+ * @param header The start of the compiled path
+ * @return true if every site is one a valid path file would give
+ */
+static bool compiled_sites_valid(const CompiledHeader *header) {
+    const CompiledSite *sites = (const CompiledSite *) (header + 1);
+    int count = (int) header->count;
+    const char *line = (const char *) &sites[count];
+    if (count < 2 || strlen(line) != header->lineLength) {
+        return false;
+    }
+    for (int siteNum = 0; siteNum < count; ++siteNum) {
+        const CompiledSite *site = &sites[siteNum];
+        char type[3] = {site->type[0], site->type[1], '\0'};
+        if (site->kind >= NUM_SITE_KINDS || site->kind != site_kind(type)) {
+            return false;
+        }
+        bool barrier = site->kind == SITE_BARRIER;
+        if ((siteNum == 0 || siteNum == count - 1) && !barrier) {
+            return false;
+        }
+        if (barrier ? site->capacity != 0 : site->capacity < 1 ||
+                site->capacity > MAX_SITE_CAPACITY) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Checks every card of a compiled deck is one of A to E, or 0 for a card
+ *  the deck file left out.
+ *
+ * @param header The start of the compiled deck
+ * @return true if every card is valid
+ */
+static bool compiled_cards_valid(const CompiledHeader *header) {
+    const char *cards = (const char *) (header + 1);
+    // deck_valid wants at least four
+    if (header->count < 4) {
+        return false;
+    }
+    for (uint32_t cardNum = 0; cardNum < header->count; ++cardNum) {
+        if (cards[cardNum] != 0 &&
+                (cards[cardNum] < 'A' || cards[cardNum] > 'E')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Maps a compiled file read-only, if it is one this version wrote and
+ *  every record in it is valid.
+ *
+ * @param compiledName The compiled file
+ * @param kind COMPILED_PATH or COMPILED_DECK
+ * @return The mapped file, or NULL if it is missing or malformed, in
+ * which case it is compiled again from the source.
+ */
+static CompiledHeader *map_compiled(const char *compiledName, char kind) {
+    int fd = open(compiledName, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1 ||
+            info.st_size < (off_t) sizeof(CompiledHeader)) {
+        close(fd);
+        return NULL;
+    }
+    CompiledHeader *header = mmap(NULL, info.st_size, PROT_READ,
+            MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (memcmp(header->magic, COMPILED_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != COMPILED_VERSION || header->kind != kind ||
+            compiled_size(header) != (size_t) info.st_size ||
+            (kind == COMPILED_PATH &&
+            ((char *) header)[info.st_size - 1] != '\0') ||
+            (kind == COMPILED_PATH ? !compiled_sites_valid(header) :
+            !compiled_cards_valid(header))) {
+        munmap(header, info.st_size);
+        return NULL;
+    }
+    return header;
+}
+
+/** Records which version of the source a compiled file was made from.
+ *
+ * @param header The start of the compiled file
+ * @param source The source file's details
+ * @param hash The hash of the source file's contents
+ */
+static void stamp_compiled(CompiledHeader *header, const struct stat *source,
+        uint64_t hash) {
+    header->contentHash = hash;
+    header->sourceSize = source->st_size;
+    header->sourceSeconds = source->st_mtim.tv_sec;
+    header->sourceNanoseconds = source->st_mtim.tv_nsec;
+}
+
+/** Returns true if the source has not been changed since the compiled file
+ *  was made, going by its size and modification time.
+ *
+ * @param header The start of the compiled file
+ * @param source The source file's details
+ * @return true if the compiled file can be used without reading the source
+ */
+static bool compiled_fresh(const CompiledHeader *header,
+        const struct stat *source) {
+    return header->sourceSize == source->st_size &&
+            header->sourceSeconds == source->st_mtim.tv_sec &&
+            header->sourceNanoseconds == source->st_mtim.tv_nsec;
+}
+
+/** Writes a compiled file, replacing any old one in a single step. Does
+ *  nothing if it cannot be written, as the compiled file is only a cache.
+ *
+ * @param compiledName The compiled file
+ * @param header The start of the compiled contents
+ */
+static void write_compiled(const char *compiledName, CompiledHeader *header) {
+    char temp[strlen(compiledName) + 16];
+    snprintf(temp, sizeof(temp), "%s.%d", compiledName, (int) getpid());
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return;
+    }
+
+    size_t size = compiled_size(header);
+    bool written = write(fd, header, size) == (ssize_t) size;
+    close(fd);
+    if (!written || rename(temp, compiledName) == -1) {
+        unlink(temp);
+    }
+}
+
+/** Makes a new compiled file with room for the given records.
+ *
+ * @param kind COMPILED_PATH or COMPILED_DECK
+ * @param count The number of sites or cards
+ * @param lineLength The length of the path's first line, 0 for decks
+ * @return The zeroed compiled contents, with the header filled in
+ */
+static CompiledHeader *new_compiled(char kind, int count, size_t lineLength) {
+    CompiledHeader layout;
+    layout.kind = kind;
+    layout.count = count;
+    layout.lineLength = lineLength;
+
+    CompiledHeader *header = calloc(1, compiled_size(&layout));
+    memcpy(header->magic, COMPILED_MAGIC, sizeof(header->magic));
+    header->version = COMPILED_VERSION;
+    header->kind = kind;
+    header->count = count;
+    header->lineLength = lineLength;
+    return header;
+}
+
+/** Validates a path file and lays out its sites.
+ *
+ * @param contents The whole path file
+ * @return The compiled contents, or NULL if the path file is invalid.
+ */
+static CompiledHeader *compile_path(char *contents) {
+    char *line = first_line(contents);
+    if (!path_contents_valid(contents, line)) {
+        return NULL;
+    }
+
+    const char *sites;
+    int size = read_site_count(line, &sites);
+    size_t lineLength = strlen(line);
+    CompiledHeader *header = new_compiled(COMPILED_PATH, size, lineLength);
+
+    bool fixedWidth = strlen(sites) == SITE_WIDTH * (size_t) size;
+
+    CompiledSite *compiled = (CompiledSite *) (header + 1);
+    for (int siteNum = 0; siteNum < size; ++siteNum) {
+        char type[3];
+        int capacity;
+        sites = next_site(sites, fixedWidth, type, &capacity);
+
+        compiled[siteNum].type[0] = type[0];
+        compiled[siteNum].type[1] = type[1];
+        compiled[siteNum].kind = site_kind(type);
+        compiled[siteNum].capacity = capacity;
+    }
+    memcpy(&compiled[size], line, lineLength + 1);
+
+    free(line);
+    return header;
+}
+
+/** Validates a deck file and lays out its cards. Cards the count promises
+ *  but the file leaves out are 0, which draw nothing.
+ *
+ * @param contents The whole deck file
+ * @return The compiled contents, or NULL if the deck file is invalid.
+ */
+static CompiledHeader *compile_deck(char *contents) {
+    char *line = first_line(contents);
+    if (!deck_valid(line)) {
+        return NULL;
+    }
+
+    // the count is read the way deck_from_line reads it
+    char count[5];
+    snprintf(count, sizeof(count), "%s", line);
+    int numberOfCards = (int) strtol(count, NULL, 10);
+    CompiledHeader *header = new_compiled(COMPILED_DECK, numberOfCards, 0);
+
+    size_t cardsGiven = strlen(line) - 1;
+    memcpy(header + 1, &line[1], cardsGiven < (size_t) numberOfCards ?
+            cardsGiven : (size_t) numberOfCards);
+
+    free(line);
+    return header;
+}
+
+/** Returns the compiled form of a path or deck file. A compiled file kept
+ *  next to the source is used if the source is unchanged; otherwise the
+ *  source is compiled again and the compiled file replaced. The compiled
+ *  form may be mapped from the compiled file, so it is never freed.
+ *
+ * @param fileName The source file
+ * @param kind COMPILED_PATH or COMPILED_DECK
+ * @param source The source file's details, from stat()
+ * @return The compiled contents, or NULL if the source cannot be read or
+ * is invalid.
+ */
+CompiledHeader *compile_source(char *fileName, char kind,
+        const struct stat *source) {
+    char *compiledName = compiled_name(fileName,
+            kind == COMPILED_PATH ? PATH_CACHE_SUFFIX : DECK_CACHE_SUFFIX);
+
+    CompiledHeader *cached = map_compiled(compiledName, kind);
+    if (cached != NULL && compiled_fresh(cached, source)) {
+        free(compiledName);
+        return cached;
+    }
+
+    size_t length;
+    char *contents = read_file(fileName, &length);
+    if (contents == NULL) {
+        free(compiledName);
+        return NULL;
+    }
+    uint64_t hash = hash_bytes(contents, length);
+
+    CompiledHeader *compiled;
+    if (cached != NULL && cached->contentHash == hash &&
+            cached->sourceSize == (int64_t) length) {
+        // only the modification time changed; keep the compiled records
+        compiled = malloc(compiled_size(cached));
+        memcpy(compiled, cached, compiled_size(cached));
+    } else if (kind == COMPILED_PATH) {
+        compiled = compile_path(contents);
+    } else {
+        compiled = compile_deck(contents);
+    }
+    if (cached != NULL) {
+        munmap(cached, compiled_size(cached));
+    }
+    free(contents);
+
+    if (compiled != NULL) {
+        stamp_compiled(compiled, source, hash);
+        write_compiled(compiledName, compiled);
+    }
+    free(compiledName);
+    return compiled;
+}
+
+/** Returns the compiled form of a path or deck file, as compile_source()
+ *  does.
+ *
+ * @param fileName The source file
+ * @param kind COMPILED_PATH or COMPILED_DECK
+ * @return The compiled contents, or NULL if the source cannot be read or
+ * is invalid.
+ */
+static CompiledHeader *load_compiled(char *fileName, char kind) {
+    struct stat source;
+    if (stat(fileName, &source) == -1) {
+        return NULL;
+    }
+    return compile_source(fileName, kind, &source);
+}
+
+/** Makes a path from its compiled form, with no parsing.
+ *
+ * @param compiled The compiled path
+ * @param numPlayers The number of players in the game
+ * @param givenPath Set to the path file's first line, which stays part of
+ * the compiled path
+ * @return The path
+ */
+Path *path_from_compiled(const CompiledHeader *compiled, int numPlayers,
+        char **givenPath) {
+    const CompiledSite *sites = (const CompiledSite *) (compiled + 1);
+    *givenPath = (char *) &sites[compiled->count];
+    return allocate_compiled_path(sites, compiled->count, numPlayers);
+}
+
+/** Makes a deck from its compiled form, with no parsing.
+ *
+ * @param compiled The compiled deck
+ * @return The deck
+ */
+Deck *deck_from_compiled(const CompiledHeader *compiled) {
+    return deck_from_cards((const char *) (compiled + 1), compiled->count);
+}
+
+/** Loads a path file through its compiled form.
+ *
+ * @param fileName The path file
+ * @param numPlayers The number of players in the game
+ * @param givenPath Set to the path file's first line, to send to players
+ * @return The path, or NULL if the file cannot be read or is invalid.
+ */
+Path *load_path(char *fileName, int numPlayers, char **givenPath) {
+    CompiledHeader *compiled = load_compiled(fileName, COMPILED_PATH);
+    if (compiled == NULL) {
+        return NULL;
+    }
+    return path_from_compiled(compiled, numPlayers, givenPath);
+}
+
+/** Loads a deck file through its compiled form, or generates a deck from
+ *  a seed:... spec.
+ *
+ * @param fileName The deck file or spec
+ * @return The deck, or NULL if the file cannot be read or is invalid.
+ */
+Deck *load_deck(char *fileName) {
+    if (is_seed_spec(fileName)) {
+        return seeded_deck(fileName);
+    }
+    CompiledHeader *compiled = load_compiled(fileName, COMPILED_DECK);
+    if (compiled == NULL) {
+        return NULL;
+    }
+    return deck_from_compiled(compiled);
+}
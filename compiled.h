@@ -0,0 +1,72 @@
+#ifndef COMPILED_H
+#define COMPILED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// the compiled form of a file is kept next to it, with this added
+#define PATH_CACHE_SUFFIX ".pathc"
+#define DECK_CACHE_SUFFIX ".deckc"
+
+// the first bytes of every compiled file, then the format version
+#define COMPILED_MAGIC "2310C"
+#define COMPILED_VERSION 2
+
+// what a compiled file holds
+#define COMPILED_PATH 'P'
+#define COMPILED_DECK 'D'
+
+struct Path;
+struct Deck;
+
+/** The start of a compiled file.
+ *
+ *  A compiled path is followed by count CompiledSites, then the path
+ *  file's first line and a NUL. A compiled deck is followed by count
+ *  cards, one byte each.
+ */
+typedef struct CompiledHeader {
+    char magic[6];
+    uint8_t version;
+    uint8_t kind;
+
+    // the source file this was compiled from: its FNV-1a hash, its size
+    // and when it was last modified
+    uint64_t contentHash;
+    int64_t sourceSize;
+    int64_t sourceSeconds;
+    int64_t sourceNanoseconds;
+
+    // the number of sites or cards
+    uint32_t count;
+
+    // the length of the first line, for paths
+    uint32_t lineLength;
+} CompiledHeader;
+
+/** A validated site. **/
+typedef struct CompiledSite {
+    char type[2];
+    uint8_t kind;
+    uint8_t unused;
+
+    // 1 to MAX_SITE_CAPACITY, or 0 for barriers which hold every player
+    uint16_t capacity;
+} CompiledSite;
+
+CompiledHeader *compile_source(char *fileName, char kind,
+        const struct stat *source);
+struct Path *path_from_compiled(const CompiledHeader *compiled,
+        int numPlayers, char **givenPath);
+struct Deck *deck_from_compiled(const CompiledHeader *compiled);
+struct Path *load_path(char *fileName, int numPlayers, char **givenPath);
+struct Deck *load_deck(char *fileName);
+
+#endif
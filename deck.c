@@ -10,10 +10,24 @@ Card *next_card(Deck *deck) {
     Card *nextCard = topCard->nextCard;
     add_card(deck, topCard);
     deck->topCard = nextCard;
+    deck->drawn = (deck->drawn + 1) % deck->count;
 
     return topCard;
 }
 
+/** Puts the card drawn last back on top of the deck.
+ *
+ * @param deck The deck
+ * @param lastCard The last card in the deck before the draw
+ */
+void return_card(Deck *deck, Card *lastCard) {
+    Card *card = deck->lastCard;
+    card->nextCard = deck->topCard;
+    deck->topCard = card;
+    deck->lastCard = lastCard;
+    deck->drawn = (deck->drawn + deck->count - 1) % deck->count;
+}
+
 /** Makes a card.
  *
  * @param value The card's value
@@ -43,25 +57,230 @@ void add_card(Deck *deck, Card *card) {
  * @return A Deck
  */
 Deck *allocate_deck(FILE *file) {
-    Deck *deck = malloc(sizeof(Deck));
-    char *line = read_line(file);
+    return deck_from_line(read_line(file));
+}
 
+/** Makes the deck from the contents of a deck file.
+ *
+ * @param line The contents of the deck file
+ * @return A Deck
+ */
+Deck *deck_from_line(char *line) {
     // get number of cards
     char *trash;
     char buff[5];
     snprintf(buff, 5, "%s", &line[0]);
     int numberOfCards = (int) strtol(buff, &trash, 10);
 
-    deck->count = numberOfCards;
+    return deck_from_cards(&line[1], numberOfCards);
+}
+
+/** Makes the deck from the given card values, top card first.
+ *
+ * @param cards The card values
+ * @param count The number of cards
+ * @return A Deck
+ */
+Deck *deck_from_cards(const char *cards, int count) {
+    Deck *deck = malloc(sizeof(Deck));
+    deck->count = count;
+    deck->seed = NULL;
+    deck->drawn = 0;
 
     // add first card
-    deck->topCard = make_card(line[1]);
+    deck->topCard = make_card(cards[0]);
     deck->lastCard = deck->topCard;
 
     // add rest of cards
     for (int cardindex = 1; cardindex < deck->count; ++cardindex) {
-        add_card(deck, make_card(line[cardindex + 1]));
+        add_card(deck, make_card(cards[cardindex]));
     }
 
     return deck;
-}
\ No newline at end of file
+}
+/** Returns a deck's cards in draw order, freeing the deck.
+ *
+ * @param deck The deck
+ * @return The cards
+ */
+char *take_cards(Deck *deck) {
+    char *cards = malloc(sizeof(char) * deck->count);
+    Card *card = deck->topCard;
+    for (int cardNum = 0; cardNum < deck->count; ++cardNum) {
+        cards[cardNum] = card->value;
+        card = card->nextCard;
+    }
+    free_deck(deck);
+    return cards;
+}
+
+/** Frees a deck and its cards.
+ *
+ * @param deck The deck
+ */
+void free_deck(Deck *deck) {
+    Card *card = deck->topCard;
+    for (int cardindex = 0; cardindex < deck->count; ++cardindex) {
+        Card *nextCard = card->nextCard;
+        free(card);
+        card = nextCard;
+    }
+    free(deck->seed);
+    free(deck);
+}
+
+/** Returns true if the deck file contents are valid.
+ *
+ * @param line The contents of the deck file
+ * @return true if the deck is valid
+ */
+bool deck_valid(char *line) {
+    // get number of cards
+    char *trash;
+    char buff[5];
+    snprintf(buff, 5, "%s", &line[0]);
+    int numberOfCards = (int) strtol(buff, &trash, 10);
+
+    if (numberOfCards < 4) {
+        return false;
+    }
+    // cards start straight after the first character
+    int cardsGiven = (int) strlen(line) - 1;
+    if (first_invalid_card(&line[1], cardsGiven) != -1) {
+        return false;
+    }
+    if (cardsGiven > numberOfCards) {
+        return false;
+    }
+
+    return true;
+}
+
+/** Returns true if the deck argument is a seed:... spec rather than a
+ *  file name.
+ *
+ * @param deckName The deck argument
+ * @return true if the deck should be generated
+ */
+bool is_seed_spec(const char *deckName) {
+    return strncmp(deckName, SEED_PREFIX, strlen(SEED_PREFIX)) == 0;
+}
+
+/** Reads an unsigned decimal number, which must be followed by end.
+ *
+ * @param cursor The start of the number; moved past end
+ * @param max The largest value allowed
+ * @param end The character which must follow the digits
+ * @param value Set to the number read
+ * @return true if a number in range followed by end was read
+ */
+static bool scan_number(const char **cursor, uint64_t max, char end,
+        uint64_t *value) {
+    const char *at = *cursor;
+    if (*at < '0' || *at > '9') {
+        return false;
+    }
+    *value = 0;
+    for (; *at >= '0' && *at <= '9'; ++at) {
+        uint64_t digit = *at - '0';
+        if (*value > (max - digit) / 10) {
+            return false;
+        }
+        *value = *value * 10 + digit;
+    }
+    if (*at != end) {
+        return false;
+    }
+    *cursor = at + 1;
+    return true;
+}
+
+/** Parses a seed:<n>:<len>[:<A>,<B>,<C>,<D>,<E>] deck spec.
+ *
+ * @param spec The deck argument
+ * @param parsed Set to the seed, the number of cards and the weights
+ * @return true if the spec is valid; it has 4 to SEED_MAX_CARDS cards and
+ * weights which are not all 0
+ */
+bool parse_seed_spec(const char *spec, SeedSpec *parsed) {
+    if (!is_seed_spec(spec)) {
+        return false;
+    }
+    const char *cursor = spec + strlen(SEED_PREFIX);
+    uint64_t value;
+
+    if (!scan_number(&cursor, UINT64_MAX, ':', &value)) {
+        return false;
+    }
+    parsed->seed = value;
+
+    bool hasWeights = strchr(cursor, ':') != NULL;
+    if (!scan_number(&cursor, SEED_MAX_CARDS, hasWeights ? ':' : '\0',
+            &value) || value < 4) {
+        return false;
+    }
+    parsed->count = (int) value;
+
+    uint64_t totalWeight = 0;
+    for (int suit = 0; suit < 5; ++suit) {
+        parsed->weights[suit] = 1;
+        if (hasWeights) {
+            if (!scan_number(&cursor, SEED_MAX_WEIGHT,
+                    suit == 4 ? '\0' : ',', &value)) {
+                return false;
+            }
+            parsed->weights[suit] = (int) value;
+        }
+        totalWeight += parsed->weights[suit];
+    }
+    return totalWeight > 0;
+}
+
+/** Generates the deck a seed:... spec describes. The same spec always
+ *  gives the same deck.
+ *
+ * @param spec The deck argument
+ * @return A Deck, or NULL if the spec is invalid.
+ */
+Deck *seeded_deck(const char *spec) {
+    SeedSpec parsed;
+    if (!parse_seed_spec(spec, &parsed)) {
+        return NULL;
+    }
+
+    uint64_t totalWeight = 0;
+    for (int suit = 0; suit < 5; ++suit) {
+        totalWeight += parsed.weights[suit];
+    }
+
+    uint64_t state = parsed.seed;
+    Deck *deck = malloc(sizeof(Deck));
+    deck->count = parsed.count;
+    deck->topCard = NULL;
+    deck->drawn = 0;
+    for (int cardIndex = 0; cardIndex < parsed.count; ++cardIndex) {
+        // scale the top 32 bits into [0, totalWeight)
+        uint64_t pick = ((next_random(&state) >> 32) * totalWeight) >> 32;
+        int suit = 0;
+        while (pick >= (uint64_t) parsed.weights[suit]) {
+            pick -= parsed.weights[suit];
+            ++suit;
+        }
+
+        Card *card = make_card('A' + suit);
+        if (deck->topCard == NULL) {
+            deck->topCard = card;
+            deck->lastCard = card;
+        } else {
+            add_card(deck, card);
+        }
+    }
+
+    // record every parameter, defaults included
+    char seed[96];
+    snprintf(seed, sizeof(seed), SEED_PREFIX "%" PRIu64 ":%d:%d,%d,%d,%d,%d",
+            parsed.seed, parsed.count, parsed.weights[0], parsed.weights[1],
+            parsed.weights[2], parsed.weights[3], parsed.weights[4]);
+    deck->seed = strdup(seed);
+    return deck;
+}
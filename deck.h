@@ -3,9 +3,19 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include "util.h"
+#include "validate.h"
 
-
+// a deck given as seed:<n>:<len>[:<A>,<B>,<C>,<D>,<E>] is generated
+// rather than read, drawing len cards with the given weights (default all
+// 1) from a PRNG seeded with n
+#define SEED_PREFIX "seed:"
+#define SEED_MAX_CARDS 1000000
+#define SEED_MAX_WEIGHT 1000000
 
 typedef struct Card Card;
 
@@ -28,11 +38,34 @@ typedef struct Deck {
 
     // the last card in deck
     Card *lastCard;
+
+    // how many cards have been drawn since the deck last went round
+    int drawn;
+
+    // the full seed:... spec the deck was generated from, or NULL if it
+    // was read from a file
+    char *seed;
 } Deck;
 
+/** A parsed seed:... deck spec. **/
+typedef struct SeedSpec {
+    uint64_t seed;
+    int count;
+    int weights[5];
+} SeedSpec;
+
 
 Card *next_card(Deck *deck);
+void return_card(Deck *deck, Card *lastCard);
 void add_card(Deck *deck, Card *card);
 
 Deck *allocate_deck(FILE *file);
-#endif
\ No newline at end of file
+Deck *deck_from_line(char *line);
+Deck *deck_from_cards(const char *cards, int count);
+void free_deck(Deck *deck);
+char *take_cards(Deck *deck);
+bool deck_valid(char *line);
+bool is_seed_spec(const char *deckName);
+bool parse_seed_spec(const char *spec, SeedSpec *parsed);
+Deck *seeded_deck(const char *spec);
+#endif
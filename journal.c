@@ -0,0 +1,110 @@
+#include "journal.h"
+
+/** Makes an empty journal.
+ *
+ * @return The journal
+ */
+Journal *create_journal(void) {
+    Journal *journal = malloc(sizeof(Journal));
+    journal->entries = NULL;
+    journal->depth = 0;
+    journal->capacity = 0;
+    return journal;
+}
+
+/** Frees a journal. The path it was kept for is left as it is.
+ *
+ * @param journal The journal
+ */
+void free_journal(Journal *journal) {
+    free(journal->entries);
+    free(journal);
+}
+
+/** Makes a move as the dealer would, landing action and Ri draw included,
+ *  and records how to take it back. The game's statistics are left alone.
+ *
+ * @param journal The journal, added to
+ * @param path The game path; if it has a deck, Ri landings draw from it
+ * @param playerId The player moving
+ * @param steps How far they move
+ * @return The card drawn as do_ri returns it, or 0 if none
+ */
+int journal_move(Journal *journal, Path *path, int playerId, int steps) {
+    if (journal->depth == journal->capacity) {
+        journal->capacity = journal->capacity == 0 ? 64 :
+                2 * journal->capacity;
+        journal->entries = realloc(journal->entries,
+                sizeof(JournalEntry) * journal->capacity);
+    }
+    JournalEntry *entry = &journal->entries[journal->depth];
+    journal->depth += 1;
+
+    Player *player = path->players[playerId];
+    entry->playerId = playerId;
+    entry->steps = steps;
+    entry->money = player->money;
+    entry->points = player->points;
+    entry->position = player->position;
+    entry->suit = -1;
+    entry->mostCards = path->mostCards;
+    entry->mostCardsHolders = path->mostCardsHolders;
+    entry->drew = false;
+
+    move_player(path, playerId, steps, PLAYER);
+    do_action(path, playerId);
+    if (path->sites[player->siteNumber].kind != SITE_RI ||
+            path->deck == NULL) {
+        return 0;
+    }
+    entry->drew = true;
+    entry->lastCard = path->deck->lastCard;
+    int card = do_ri(path, player);
+    entry->suit = card - 1;
+    return card;
+}
+
+/** Takes back the last move made with journal_move.
+ *
+ * @param journal The journal, which must not be empty
+ * @param path The game path the move was made on
+ */
+void journal_undo(Journal *journal, Path *path) {
+    journal->depth -= 1;
+    JournalEntry *entry = &journal->entries[journal->depth];
+    Player *player = path->players[entry->playerId];
+
+    SiteKind kind = path->sites[player->siteNumber].kind;
+    if (kind == SITE_V1) {
+        player->countV1 -= 1;
+    } else if (kind == SITE_V2) {
+        player->countV2 -= 1;
+    }
+    if (entry->suit != -1) {
+        player->cards[entry->suit] -= 1;
+        player->cardTotal -= 1;
+        path->totalCards -= 1;
+    }
+    path->mostCards = entry->mostCards;
+    path->mostCardsHolders = entry->mostCardsHolders;
+    if (entry->drew) {
+        return_card(path->deck, entry->lastCard);
+    }
+
+    move_player(path, entry->playerId, -entry->steps, PLAYER);
+    player->money = entry->money;
+    player->points = entry->points;
+    player->position = entry->position;
+}
+
+/** Takes back moves until only the given number are left.
+ *
+ * @param journal The journal
+ * @param path The game path the moves were made on
+ * @param depth How many moves to keep; 0 goes back to the start
+ */
+void journal_rewind(Journal *journal, Path *path, int depth) {
+    while (journal->depth > depth) {
+        journal_undo(journal, path);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "path.h"
+
+/** What a move changed that cannot be worked out from the move itself,
+ *  so that it can be taken back.
+ */
+typedef struct JournalEntry {
+    int playerId;
+    int steps;
+
+    // the mover's fields a landing may set rather than add to
+    int money;
+    int points;
+    int position;
+
+    // the card a Ri landing gave, A to E, or -1 if none was given
+    int suit;
+    int mostCards;
+    int mostCardsHolders;
+
+    // whether a card was drawn, and the deck's last card before it was
+    bool drew;
+    Card *lastCard;
+} JournalEntry;
+
+/** The moves made on a path, most recent last, each of which can be
+ *  taken back in constant time.
+ */
+typedef struct Journal {
+    JournalEntry *entries;
+    int depth;
+    int capacity;
+} Journal;
+
+Journal *create_journal(void);
+void free_journal(Journal *journal);
+int journal_move(Journal *journal, Path *path, int playerId, int steps);
+void journal_undo(Journal *journal, Path *path);
+void journal_rewind(Journal *journal, Path *path, int depth);
+
+#endif
@@ -0,0 +1,212 @@
+#define _GNU_SOURCE
+#include "logger.h"
+#include "metrics.h"
+
+/** Output written to a log, waiting to be written out by the writer thread.
+ *  The process's main thread is the only producer and the writer thread
+ *  the only consumer, so head and tail are each only stored by one side.
+ */
+typedef struct Log {
+    // the fd the writer thread writes to
+    int fd;
+
+    // the FILE the rest of the program writes to
+    FILE *file;
+
+    // the process which started the writer thread
+    pid_t owner;
+
+    // bytes written in and bytes written out; both only ever increase
+    size_t head;
+    size_t tail;
+
+    // set while the writer thread is waiting for output, and while the
+    // main thread is waiting for the writer thread to write some out
+    int sleeping;
+    int waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t space;
+
+    char buffer[LOG_BUFFER_SIZE];
+} Log;
+
+// the process has at most one log
+static Log *processLog = NULL;
+
+/** Wakes the writer thread if it is waiting for output.
+ *
+ * @param log The log
+ */
+static void wake_writer(Log *log) {
+    if (__atomic_load_n(&log->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&log->lock);
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    }
+}
+
+/** Waits until the writer thread has written out the given number of
+ *  bytes in all.
+ *
+ * @param log The log
+ * @param until How far tail has to get
+ */
+static void wait_for_writer(Log *log, size_t until) {
+    pthread_mutex_lock(&log->lock);
+    __atomic_store_n(&log->waiting, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&log->tail, __ATOMIC_SEQ_CST) < until) {
+        pthread_cond_signal(&log->wake);
+        pthread_cond_wait(&log->space, &log->lock);
+    }
+    __atomic_store_n(&log->waiting, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&log->lock);
+}
+
+/** Writer thread: writes out everything in the buffer with as few writes
+ *  as it can, sleeping while the buffer is empty and telling the main
+ *  thread when it has made space.
+ *
+ * @param arg The log
+ * @return Never returns.
+ */
+static void *write_log(void *arg) {
+    Log *log = arg;
+    while (true) {
+        size_t head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+        size_t tail = log->tail;
+
+        if (head == tail) {
+            pthread_mutex_lock(&log->lock);
+            __atomic_store_n(&log->sleeping, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&log->head, __ATOMIC_SEQ_CST) == tail) {
+                pthread_cond_wait(&log->wake, &log->lock);
+            }
+            __atomic_store_n(&log->sleeping, 0, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&log->lock);
+            continue;
+        }
+
+        // everything up to head, or up to the end of the buffer if it wraps
+        size_t start = tail % LOG_BUFFER_SIZE;
+        size_t length = head - tail;
+        if (start + length > LOG_BUFFER_SIZE) {
+            length = LOG_BUFFER_SIZE - start;
+        }
+
+        ssize_t written = write(log->fd, &log->buffer[start], length);
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        // output which can't be written is dropped so nothing waits forever
+        if (written <= 0) {
+            written = length;
+        } else {
+            count_bytes(CHANNEL_LOG, written);
+        }
+        __atomic_store_n(&log->tail, tail + written, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&log->waiting, __ATOMIC_SEQ_CST)) {
+            pthread_mutex_lock(&log->lock);
+            pthread_cond_signal(&log->space);
+            pthread_mutex_unlock(&log->lock);
+        }
+    }
+    return NULL;
+}
+
+/** Copies output into the buffer, waiting for the writer thread while the
+ *  buffer is full. Called by stdio whenever the log FILE is flushed.
+ *
+ * @param cookie The log
+ * @param data The output
+ * @param size The number of bytes of output
+ * @return size
+ */
+static ssize_t push_log(void *cookie, const char *data, size_t size) {
+    Log *log = cookie;
+    size_t done = 0;
+
+    while (done < size) {
+        size_t head = log->head;
+        size_t tail = __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE);
+        size_t space = LOG_BUFFER_SIZE - (head - tail);
+        if (space == 0) {
+            wait_for_writer(log, tail + 1);
+            continue;
+        }
+
+        size_t start = head % LOG_BUFFER_SIZE;
+        size_t length = size - done;
+        if (length > space) {
+            length = space;
+        }
+        if (start + length > LOG_BUFFER_SIZE) {
+            length = LOG_BUFFER_SIZE - start;
+        }
+        memcpy(&log->buffer[start], &data[done], length);
+        done += length;
+        __atomic_store_n(&log->head, head + length, __ATOMIC_SEQ_CST);
+    }
+
+    wake_writer(log);
+    return size;
+}
+
+/** Waits until everything written to the log has been written out. Run at
+ *  exit, and before anything else is written to the log's fd directly.
+ */
+void drain_log(void) {
+    Log *log = processLog;
+    // the writer thread only exists in the process which started it
+    if (log == NULL || log->owner != getpid()) {
+        return;
+    }
+
+    fflush(log->file);
+    wait_for_writer(log, __atomic_load_n(&log->head, __ATOMIC_ACQUIRE));
+}
+
+/** Returns a FILE which writes to the stream's fd from a background thread,
+ *  so that writes and flushes only copy into memory. The output is the same
+ *  as writing to the stream.
+ *
+ * @param stream The stream to write to, eg stdout
+ * @return The log FILE, or stream itself if the thread can't be started.
+ */
+FILE *open_log(FILE *stream) {
+    if (processLog != NULL && processLog->owner == getpid()) {
+        return processLog->file;
+    }
+
+    Log *log = malloc(sizeof(Log));
+    fflush(stream);
+    log->fd = fileno(stream);
+    log->owner = getpid();
+    log->head = 0;
+    log->tail = 0;
+    log->sleeping = 0;
+    log->waiting = 0;
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    pthread_cond_init(&log->space, NULL);
+
+    cookie_io_functions_t functions = {NULL, push_log, NULL, NULL};
+    log->file = fopencookie(log, "w", functions);
+
+    if (log->file == NULL) {
+        free(log);
+        return stream;
+    }
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, write_log, log) != 0) {
+        fclose(log->file);
+        free(log);
+        return stream;
+    }
+    pthread_detach(writer);
+    setvbuf(log->file, NULL, _IOFBF, BUFSIZ);
+
+    processLog = log;
+    atexit(drain_log);
+    return log->file;
+}
@@ -0,0 +1,19 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// bytes of output which may be waiting for the writer thread; writes past
+// this wait for it to catch up rather than use more memory
+#define LOG_BUFFER_SIZE (1 << 20)
+
+FILE *open_log(FILE *stream);
+void drain_log(void);
+
+#endif
@@ -0,0 +1,310 @@
+#include "metrics.h"
+
+// upper bounds of the latency buckets, in nanoseconds
+static const int64_t bucketBounds[METRICS_BUCKETS] = {
+    10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000,
+    1000000000, 2500000000, 5000000000, 10000000000
+};
+
+static const char *channelNames[NUM_CHANNELS] = {
+    "players", "log", "spectators", "transcript"
+};
+
+static const char *phaseNames[NUM_PHASES] = {
+    "start", "think", "move", "end"
+};
+
+static const char *errorNames[METRICS_EXIT_CODES] = {
+    NULL, "args", "deck", "path", "starting_player", "communication"
+};
+
+// the metrics shared by this process and any games it forks, or NULL
+static Metrics *processMetrics = NULL;
+
+// players this process started and has not counted as done; given back if
+// it exits part way through a game
+static int processPlayers = 0;
+
+// the process which writes the metrics file, and where and how often
+static pid_t owner;
+static char *metricsFile;
+static int intervalMillis;
+
+// writes from the writer thread and at exit take turns
+static pthread_mutex_t writing = PTHREAD_MUTEX_INITIALIZER;
+
+// turns and time at the last write, for the turn rate
+static uint64_t lastTurns = 0;
+static struct timespec lastWrite;
+
+/** Adds to a counter shared with other processes.
+ *
+ * @param counter The shared counter
+ * @param amount How much to add
+ */
+static void add_shared(uint64_t *counter, uint64_t amount) {
+    __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+}
+
+/** Reads a counter shared with other processes.
+ *
+ * @param counter The shared counter
+ * @return Its value
+ */
+static uint64_t read_shared(uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/** Writes a counter's or gauge's HELP and TYPE lines.
+ *
+ * @param file Where to write
+ * @param name The metric's name
+ * @param type "counter", "gauge" or "histogram"
+ * @param help What it measures
+ */
+static void write_header(FILE *file, const char *name, const char *type,
+        const char *help) {
+    fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/** Writes the phase latency histograms, with cumulative buckets.
+ *
+ * @param file Where to write
+ * @param metrics The metrics
+ */
+static void write_histograms(FILE *file, Metrics *metrics) {
+    write_header(file, "dealer_phase_seconds", "histogram",
+            "Time spent in each phase of a game.");
+    for (int phase = 0; phase < NUM_PHASES; ++phase) {
+        Histogram *histogram = &metrics->phases[phase];
+        uint64_t total = 0;
+        for (int bucket = 0; bucket < METRICS_BUCKETS; ++bucket) {
+            total += read_shared(&histogram->buckets[bucket]);
+            fprintf(file, "dealer_phase_seconds_bucket{phase=\"%s\","
+                    "le=\"%g\"} %llu\n", phaseNames[phase],
+                    bucketBounds[bucket] / 1e9,
+                    (unsigned long long) total);
+        }
+        total += read_shared(&histogram->buckets[METRICS_BUCKETS]);
+        fprintf(file, "dealer_phase_seconds_bucket{phase=\"%s\","
+                "le=\"+Inf\"} %llu\n", phaseNames[phase],
+                (unsigned long long) total);
+        fprintf(file, "dealer_phase_seconds_sum{phase=\"%s\"} %.9f\n",
+                phaseNames[phase],
+                read_shared(&histogram->sumNanos) / 1e9);
+        fprintf(file, "dealer_phase_seconds_count{phase=\"%s\"} %llu\n",
+                phaseNames[phase], (unsigned long long) total);
+    }
+}
+
+/** Writes every metric in Prometheus' text format.
+ *
+ * @param file Where to write
+ * @param metrics The metrics
+ * @param turnRate Turns per second since the last write
+ */
+static void write_metrics(FILE *file, Metrics *metrics, double turnRate) {
+    write_header(file, "dealer_games_started_total", "counter",
+            "Games started.");
+    fprintf(file, "dealer_games_started_total %llu\n",
+            (unsigned long long) read_shared(&metrics->gamesStarted));
+    write_header(file, "dealer_games_finished_total", "counter",
+            "Games played to the end.");
+    fprintf(file, "dealer_games_finished_total %llu\n",
+            (unsigned long long) read_shared(&metrics->gamesFinished));
+    write_header(file, "dealer_turns_total", "counter", "Moves made.");
+    fprintf(file, "dealer_turns_total %llu\n",
+            (unsigned long long) read_shared(&metrics->turns));
+    write_header(file, "dealer_turns_per_second", "gauge",
+            "Moves made per second since the metrics were last written.");
+    fprintf(file, "dealer_turns_per_second %.3f\n", turnRate);
+    write_header(file, "dealer_active_players", "gauge",
+            "Players in games which are still running.");
+    fprintf(file, "dealer_active_players %ld\n", (long) __atomic_load_n(
+            &metrics->activePlayers, __ATOMIC_RELAXED));
+
+    write_header(file, "dealer_bytes_written_total", "counter",
+            "Bytes the dealer has written, by where they went.");
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
+        fprintf(file, "dealer_bytes_written_total{channel=\"%s\"} %llu\n",
+                channelNames[channel],
+                (unsigned long long) read_shared(&metrics->bytes[channel]));
+    }
+    write_header(file, "dealer_errors_total", "counter",
+            "Games ended by an error, by the dealer's exit code.");
+    for (int code = INVALID_NUM_ARGS; code < METRICS_EXIT_CODES; ++code) {
+        fprintf(file, "dealer_errors_total{code=\"%d\",error=\"%s\"} %llu\n",
+                code, errorNames[code],
+                (unsigned long long) read_shared(&metrics->errors[code]));
+    }
+    write_histograms(file, metrics);
+}
+
+/** Rewrites the metrics file. It is written beside the file and renamed
+ *  over it, so a reader never sees it half written.
+ */
+static void write_metrics_file(void) {
+    pthread_mutex_lock(&writing);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t turns = read_shared(&processMetrics->turns);
+    double seconds = (now.tv_sec - lastWrite.tv_sec) +
+            (now.tv_nsec - lastWrite.tv_nsec) / 1e9;
+    double turnRate = seconds > 0 ? (turns - lastTurns) / seconds : 0;
+    lastTurns = turns;
+    lastWrite = now;
+
+    size_t length = strlen(metricsFile) + strlen(".tmp") + 1;
+    char partFile[length];
+    snprintf(partFile, length, "%s.tmp", metricsFile);
+    FILE *file = fopen(partFile, "w");
+    if (file != NULL) {
+        write_metrics(file, processMetrics, turnRate);
+        if (fclose(file) == 0) {
+            rename(partFile, metricsFile);
+        }
+    }
+    pthread_mutex_unlock(&writing);
+}
+
+/** Writes the metrics a last time when the writing process exits. **/
+static void write_final_metrics(void) {
+    if (getpid() == owner) {
+        write_metrics_file();
+    }
+}
+
+/** Writer thread: rewrites the metrics file every interval.
+ *
+ * @param arg Unused
+ * @return Never returns.
+ */
+static void *write_metrics_often(void *arg) {
+    struct timespec wait;
+    wait.tv_sec = intervalMillis / 1000;
+    wait.tv_nsec = (long) (intervalMillis % 1000) * 1000000;
+    while (true) {
+        nanosleep(&wait, NULL);
+        write_metrics_file();
+    }
+    return NULL;
+}
+
+/** Starts the live metrics if METRICS_ENV is set: the counters are shared
+ *  with every game forked after this, and this process rewrites the file
+ *  from a background thread and once more when it exits.
+ */
+void create_metrics(void) {
+    char *fileName = getenv(METRICS_ENV);
+    if (fileName == NULL || processMetrics != NULL) {
+        return;
+    }
+    Metrics *metrics = mmap(NULL, sizeof(Metrics), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (metrics == MAP_FAILED) {
+        return;
+    }
+    // anonymous mappings start zeroed
+    processMetrics = metrics;
+    owner = getpid();
+    metricsFile = fileName;
+    char *interval = getenv(METRICS_INTERVAL_ENV);
+    intervalMillis = interval != NULL && atoi(interval) > 0 ?
+            atoi(interval) : DEFAULT_METRICS_INTERVAL_MS;
+    clock_gettime(CLOCK_MONOTONIC, &lastWrite);
+
+    write_metrics_file();
+    atexit(write_final_metrics);
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, write_metrics_often, NULL) == 0) {
+        pthread_detach(writer);
+    }
+}
+
+/** Counts a game being started. **/
+void count_game_started(void) {
+    if (processMetrics != NULL) {
+        add_shared(&processMetrics->gamesStarted, 1);
+    }
+}
+
+/** Counts a game being played to the end. **/
+void count_game_finished(void) {
+    if (processMetrics != NULL) {
+        add_shared(&processMetrics->gamesFinished, 1);
+    }
+}
+
+/** Counts a move being made. **/
+void count_turn(void) {
+    if (processMetrics != NULL) {
+        add_shared(&processMetrics->turns, 1);
+    }
+}
+
+/** Changes the number of active players.
+ *
+ * @param change Players started, or minus the players done with
+ */
+void count_players(int change) {
+    if (processMetrics != NULL) {
+        processPlayers += change;
+        __atomic_fetch_add(&processMetrics->activePlayers, change,
+                __ATOMIC_RELAXED);
+    }
+}
+
+/** Counts bytes written by the dealer.
+ *
+ * @param channel Where they were written
+ * @param bytes How many were written
+ */
+void count_bytes(MetricChannel channel, uint64_t bytes) {
+    if (processMetrics != NULL) {
+        add_shared(&processMetrics->bytes[channel], bytes);
+    }
+}
+
+/** Counts a game ending with an error.
+ *
+ * @param errorCode The code the dealer exits with, or reports, for it
+ */
+void count_error(DealerErrorCode errorCode) {
+    if (processMetrics != NULL && errorCode > NORMAL_END &&
+            errorCode < METRICS_EXIT_CODES) {
+        add_shared(&processMetrics->errors[errorCode], 1);
+    }
+}
+
+/** Counts the dealer exiting, and gives back the players of a game it was
+ *  running.
+ *
+ * @param errorCode The code it exits with
+ */
+void count_exit(DealerErrorCode errorCode) {
+    if (processMetrics == NULL) {
+        return;
+    }
+    count_error(errorCode);
+    count_players(-processPlayers);
+}
+
+/** Counts the time taken by one run of a phase.
+ *
+ * @param phase The phase
+ * @param nanos How long it took
+ */
+void observe_phase(MetricPhase phase, int64_t nanos) {
+    if (processMetrics == NULL) {
+        return;
+    }
+    Histogram *histogram = &processMetrics->phases[phase];
+    int bucket = 0;
+    while (bucket < METRICS_BUCKETS && nanos > bucketBounds[bucket]) {
+        bucket += 1;
+    }
+    add_shared(&histogram->buckets[bucket], 1);
+    add_shared(&histogram->sumNanos, nanos > 0 ? nanos : 0);
+}
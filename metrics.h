@@ -0,0 +1,89 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "util.h"
+
+// set on the dealer to a file which is rewritten with the live metrics in
+// Prometheus' text format, eg for node_exporter's textfile collector
+#define METRICS_ENV "DEALER_METRICS"
+
+// set to how many milliseconds apart the metrics file is rewritten
+#define METRICS_INTERVAL_ENV "DEALER_METRICS_INTERVAL"
+#define DEFAULT_METRICS_INTERVAL_MS 1000
+
+// latency buckets per phase; times past the last bound only count in +Inf
+#define METRICS_BUCKETS 19
+
+// dealer errors counted, indexed by DealerErrorCode
+#define METRICS_EXIT_CODES (COMMUNICATION_ERROR + 1)
+
+/** Where the dealer's output goes. **/
+typedef enum MetricChannel {
+    // YT, the path and broadcast HAP, DONE and EARLY lines
+    CHANNEL_PLAYERS,
+    // the board and scores, as written out by the log's writer thread
+    CHANNEL_LOG,
+    // events sent to spectators
+    CHANNEL_SPECTATORS,
+    // transcripts, counted as each is closed
+    CHANNEL_TRANSCRIPT,
+    NUM_CHANNELS
+} MetricChannel;
+
+/** The parts of a game which are timed. **/
+typedef enum MetricPhase {
+    // from the game being made to the last player being sent the path
+    PHASE_START,
+    // from sending YT to having the player's move
+    PHASE_THINK,
+    // applying a move and telling everyone about it
+    PHASE_MOVE,
+    // final scores, DONE and reaping the players
+    PHASE_END,
+    NUM_PHASES
+} MetricPhase;
+
+/** Times taken by one phase, each counted in the first bucket it fits,
+ *  so the buckets add up to how many times were taken.
+ */
+typedef struct Histogram {
+    uint64_t buckets[METRICS_BUCKETS + 1];
+    uint64_t sumNanos;
+} Histogram;
+
+/** Live counters over every game the dealer runs, shared between the
+ *  processes running them. Only ever updated with relaxed atomics.
+ */
+typedef struct Metrics {
+    uint64_t gamesStarted;
+    uint64_t gamesFinished;
+    uint64_t turns;
+
+    // players started and not yet done with; a gauge
+    int64_t activePlayers;
+
+    uint64_t bytes[NUM_CHANNELS];
+    uint64_t errors[METRICS_EXIT_CODES];
+    Histogram phases[NUM_PHASES];
+} Metrics;
+
+void create_metrics(void);
+void count_game_started(void);
+void count_game_finished(void);
+void count_turn(void);
+void count_players(int change);
+void count_bytes(MetricChannel channel, uint64_t bytes);
+void count_error(DealerErrorCode errorCode);
+void count_exit(DealerErrorCode errorCode);
+void observe_phase(MetricPhase phase, int64_t nanos);
+
+#endif
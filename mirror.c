@@ -0,0 +1,172 @@
+#include "mirror.h"
+#include "path.h"
+
+/** Returns the number of bytes needed to mirror the given number of players.
+ *
+ * @param numPlayers The number of players in the game
+ * @return The size of the shared mapping
+ */
+size_t mirror_size(int numPlayers) {
+    return sizeof(Mirror) + sizeof(MirrorPlayer) * numPlayers;
+}
+
+/** Creates the shared game state if MIRROR_ENV is set. Its fd is closed
+ *  on exec, so only the game's own players are given it, by
+ *  share_mirror().
+ *
+ * @param path The initialised game path
+ * @return The shared state, or NULL if mirroring is off or unavailable.
+ */
+Mirror *create_mirror(Path *path) {
+    if (getenv(MIRROR_ENV) == NULL) {
+        return NULL;
+    }
+
+    // one process may run many games, each with its own state
+    static unsigned int mirrorsMade = 0;
+    char name[48];
+    snprintf(name, sizeof(name), "/2310dealer.%d.%u", (int) getpid(),
+            mirrorsMade++);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        return NULL;
+    }
+    // only the fd is needed from here on
+    shm_unlink(name);
+
+    size_t size = mirror_size(path->playersInGame);
+    if (ftruncate(fd, size) == -1) {
+        close(fd);
+        return NULL;
+    }
+    Mirror *mirror = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+            0);
+    if (mirror == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    mirror->sequence = 0;
+    mirror->fd = fd;
+    mirror->size = path->size;
+    mirror->playersInGame = path->playersInGame;
+    publish_mirror(mirror, path);
+
+    return mirror;
+}
+
+/** Lets a player inherit the shared state's fd across exec and exports it
+ *  through MIRROR_FD_ENV. Called in the player's process before exec.
+ *
+ * @param mirror The shared state
+ */
+void share_mirror(Mirror *mirror) {
+    fcntl(mirror->fd, F_SETFD, 0);
+    char fdString[12];
+    snprintf(fdString, sizeof(fdString), "%d", mirror->fd);
+    setenv(MIRROR_FD_ENV, fdString, 1);
+}
+
+/** Unmaps the shared state and closes its fd once the game is over.
+ *
+ * @param mirror The shared state
+ */
+void free_mirror(Mirror *mirror) {
+    close(mirror->fd);
+    munmap(mirror, mirror_size(mirror->playersInGame));
+}
+
+/** Maps the dealer's shared game state read-only if MIRROR_FD_ENV is set.
+ *
+ * @param path The player's game path
+ * @return The shared state, or NULL if the player should follow HAPs.
+ */
+Mirror *attach_mirror(Path *path) {
+    char *fdString = getenv(MIRROR_FD_ENV);
+    if (fdString == NULL) {
+        return NULL;
+    }
+
+    char *trash;
+    int fd = (int) strtol(fdString, &trash, 10);
+    Mirror *mirror = mmap(NULL, mirror_size(path->playersInGame), PROT_READ,
+            MAP_SHARED, fd, 0);
+    if (mirror == MAP_FAILED) {
+        return NULL;
+    }
+
+    // the dealer is playing a different game to us
+    if (mirror->size != path->size ||
+            mirror->playersInGame != path->playersInGame) {
+        munmap(mirror, mirror_size(path->playersInGame));
+        return NULL;
+    }
+
+    return mirror;
+}
+
+/** Writes every player's state to the shared state.
+ *
+ * @param mirror The shared state
+ * @param path The dealer's game path
+ */
+void publish_mirror(Mirror *mirror, Path *path) {
+    __atomic_store_n(&mirror->sequence, mirror->sequence + 1,
+            __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        Player *player = path->players[playerId];
+        MirrorPlayer *copy = &mirror->players[playerId];
+
+        copy->money = player->money;
+        copy->siteNumber = player->siteNumber;
+        copy->countV1 = player->countV1;
+        copy->countV2 = player->countV2;
+        copy->points = player->points;
+        copy->position = player->position;
+        memcpy(copy->cards, player->cards, sizeof(int) * NUM_CARDS);
+    }
+
+    __atomic_store_n(&mirror->sequence, mirror->sequence + 1,
+            __ATOMIC_RELEASE);
+}
+
+/** Takes a consistent snapshot of the shared state and applies it to the
+ *  player's copy of the path.
+ *
+ * @param mirror The shared state
+ * @param path The player's game path
+ */
+void read_mirror(Mirror *mirror, Path *path) {
+    MirrorPlayer snapshot[path->playersInGame];
+    unsigned int sequence;
+
+    // retry until the dealer was not writing for the whole copy
+    do {
+        sequence = __atomic_load_n(&mirror->sequence, __ATOMIC_ACQUIRE);
+        memcpy(snapshot, mirror->players, sizeof(snapshot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 ||
+            __atomic_load_n(&mirror->sequence, __ATOMIC_RELAXED) != sequence);
+
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        Player *player = path->players[playerId];
+        MirrorPlayer *copy = &snapshot[playerId];
+
+        if (copy->siteNumber < 0 || copy->siteNumber >= path->size) {
+            player_exit(PLAYER_COMMUNICATION_ERROR);
+        }
+        if (copy->siteNumber != player->siteNumber) {
+            move_player(path, playerId, copy->siteNumber -
+                    player->siteNumber, PLAYER);
+        }
+        player->money = copy->money;
+        player->countV1 = copy->countV1;
+        player->countV2 = copy->countV2;
+        player->points = copy->points;
+        player->position = copy->position;
+        memcpy(player->cards, copy->cards, sizeof(int) * NUM_CARDS);
+    }
+    recount_cards(path);
+}
@@ -0,0 +1,57 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// set on the dealer to publish the game state to players
+#define MIRROR_ENV "DEALER_MIRROR"
+// set by the dealer for players; the fd of the shared state
+#define MIRROR_FD_ENV "DEALER_MIRROR_FD"
+
+// cards in a hand, matching NUM_CARDS in path.h
+#define MIRROR_CARDS 5
+
+struct Path;
+
+/** A player's state as published by the dealer. **/
+typedef struct MirrorPlayer {
+    int money;
+    int siteNumber;
+    int countV1;
+    int countV2;
+    int points;
+    int position;
+    int cards[MIRROR_CARDS];
+} MirrorPlayer;
+
+/** The dealer's game state, shared read-only with players. Site occupancy
+ *  is not stored as it follows from each player's siteNumber.
+ */
+typedef struct Mirror {
+    // odd while the dealer is writing, bumped before and after each write
+    unsigned int sequence;
+
+    // the dealer's fd for the shared state
+    int fd;
+
+    // the number of sites and players, to check the players agree
+    int size;
+    int playersInGame;
+
+    // the state of each player
+    MirrorPlayer players[];
+} Mirror;
+
+Mirror *create_mirror(struct Path *path);
+void share_mirror(Mirror *mirror);
+void free_mirror(Mirror *mirror);
+Mirror *attach_mirror(struct Path *path);
+void publish_mirror(Mirror *mirror, struct Path *path);
+void read_mirror(Mirror *mirror, struct Path *path);
+
+#endif
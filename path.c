@@ -14,13 +14,13 @@ int check_player_args(int argc, char **argv) {
 
     char *trash;
 
-    char *validIDs = "0123456789";
-
     // check number of sites is more than 2
     int playerCount = (int) strtol(argv[1], &trash, 10);
     int playerID = (int) strtol(argv[2], &trash, 10);
 
-    if (strstr(validIDs, argv[2]) == NULL || strlen(argv[2]) == 0) {
+    // the ID must be all digits
+    if (strlen(argv[2]) == 0 || strspn(argv[2], "0123456789") !=
+            strlen(argv[2]) || strlen(argv[2]) > 3) {
         player_exit(INVALID_ID);
     }
 
@@ -34,6 +34,288 @@ int check_player_args(int argc, char **argv) {
     return 0;
 }
 
+/** Returns which player a player program plays as, for programs which
+ *  play games without starting players.
+ *
+ * @param program A or B, or the name of the 2310A or 2310B program
+ * @return 'A' or 'B', or 0 if the program is neither
+ */
+char program_player_type(const char *program) {
+    const char *name = strrchr(program, '/');
+    name = name == NULL ? program : name + 1;
+    if (strcmp(name, "A") == 0 || strcmp(name, "2310A") == 0) {
+        return 'A';
+    }
+    if (strcmp(name, "B") == 0 || strcmp(name, "2310B") == 0) {
+        return 'B';
+    }
+    return 0;
+}
+
+/** Returns the kind of site for the given site type.
+ *
+ * @param type The site type, eg "Mo"
+ * @return The matching SiteKind
+ */
+SiteKind site_kind(char *type) {
+    if (strcmp(type, MO) == 0) {
+        return SITE_MO;
+    }
+    if (strcmp(type, V1) == 0) {
+        return SITE_V1;
+    }
+    if (strcmp(type, V2) == 0) {
+        return SITE_V2;
+    }
+    if (strcmp(type, DO) == 0) {
+        return SITE_DO;
+    }
+    if (strcmp(type, RI) == 0) {
+        return SITE_RI;
+    }
+    if (strcmp(type, BARRIER) == 0) {
+        return SITE_BARRIER;
+    }
+    return SITE_OTHER;
+}
+
+/** Sets or clears the site's bit in the open sites bitset depending on
+ *  whether it has room for another player.
+ *
+ * @param path The game path
+ * @param siteID The site to update
+ */
+void update_open_site(Path *path, int siteID) {
+    Site *site = &path->sites[siteID];
+    uint64_t *word = &path->openSites[siteID / BITSET_WORD_BITS];
+    uint64_t bit = (uint64_t) 1 << (siteID % BITSET_WORD_BITS);
+    bool wasOpen = (*word & bit) != 0;
+    bool open = site->numPlayersCurrently < site->playerLimit;
+
+    if (open) {
+        *word |= bit;
+    } else {
+        *word &= ~bit;
+    }
+    if (open != wasOpen) {
+        path->runs[find_run(path, siteID)].fullSites += open ? -1 : 1;
+    }
+}
+
+/** Returns the run the site is in.
+ *
+ * @param path The game path
+ * @param siteID The site
+ * @return The index of the run in path->runs
+ */
+int find_run(Path *path, int siteID) {
+    int low = 0;
+    int high = path->numRuns - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (path->runs[middle].start <= siteID) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+/** Gives the site its type and capacity, sharing the previous site's type
+ *  string and run if they are the same.
+ *
+ * @param path The game path, with sites before this one filled in
+ * @param siteNum The site
+ * @param type The site's type
+ * @param playerLimit The most players the site can hold
+ */
+static void fill_site(Path *path, int siteNum, const char *type,
+        int playerLimit) {
+    Site *site = &path->sites[siteNum];
+    Site *previous = siteNum > 0 ? &path->sites[siteNum - 1] : NULL;
+    site->playerLimit = playerLimit;
+    init_occupants(site);
+
+    if (previous != NULL && previous->playerLimit == playerLimit &&
+            strcmp(previous->type, type) == 0) {
+        site->type = previous->type;
+        site->kind = previous->kind;
+        path->runs[path->numRuns - 1].length += 1;
+        path->runs[path->numRuns - 1].fullSites += 1;
+        return;
+    }
+
+    site->type = malloc(sizeof(char) * 3);
+    strcpy(site->type, type);
+    site->kind = site_kind(site->type);
+    if ((path->numRuns & (path->numRuns - 1)) == 0) {
+        path->runs = realloc(path->runs, sizeof(SiteRun) *
+                (path->numRuns == 0 ? 1 : 2 * path->numRuns));
+    }
+    // every site counts as full until allocate_site_bitsets opens it
+    SiteRun *run = &path->runs[path->numRuns];
+    run->start = siteNum;
+    run->length = 1;
+    run->kind = site->kind;
+    run->fullSites = 1;
+    path->numRuns += 1;
+}
+
+/** Allocates the site kind and open site bitsets for the path.
+ *
+ * @param path The game path, with its sites already allocated
+ */
+void allocate_site_bitsets(Path *path) {
+    int words = (path->size + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+    path->bitsetWords = words;
+    path->openSites = calloc(words, sizeof(uint64_t));
+
+    for (int kind = 0; kind < NUM_SITE_KINDS; ++kind) {
+        path->siteKinds[kind] = calloc(words, sizeof(uint64_t));
+    }
+
+    for (int siteID = 0; siteID < path->size; ++siteID) {
+        path->siteKinds[path->sites[siteID].kind][siteID / BITSET_WORD_BITS]
+                |= (uint64_t) 1 << (siteID % BITSET_WORD_BITS);
+        update_open_site(path, siteID);
+    }
+    path->scanRuns = path->size >= RUN_SCAN_MIN_LENGTH * path->numRuns;
+}
+
+/** Finds the first matching site in [from, to) a word of the bitsets at
+ *  a time.
+ *
+ * @param path The game path
+ * @param kinds The KIND_BIT()s of the site kinds to match
+ * @param openOnly Whether to only match sites with room for another player
+ * @param from The first site to check, a site on the path
+ * @param to One past the last site to check, after from
+ * @return The ID of the first matching site, or -1 if there is none.
+ */
+static int find_site_in_bitsets(Path *path, unsigned int kinds,
+        bool openOnly, int from, int to) {
+    int lastWord = (to - 1) / BITSET_WORD_BITS;
+    for (int word = from / BITSET_WORD_BITS; word <= lastWord; ++word) {
+        uint64_t bits = 0;
+        for (int kind = 0; kind < NUM_SITE_KINDS; ++kind) {
+            if (kinds & KIND_BIT(kind)) {
+                bits |= path->siteKinds[kind][word];
+            }
+        }
+        if (openOnly) {
+            bits &= path->openSites[word];
+        }
+
+        // mask off sites before from and from to onwards
+        if (word == from / BITSET_WORD_BITS) {
+            bits &= ~(uint64_t) 0 << (from % BITSET_WORD_BITS);
+        }
+        if (word == lastWord && to % BITSET_WORD_BITS != 0) {
+            bits &= ((uint64_t) 1 << (to % BITSET_WORD_BITS)) - 1;
+        }
+
+        if (bits != 0) {
+            return word * BITSET_WORD_BITS + __builtin_ctzll(bits);
+        }
+    }
+    return -1;
+}
+
+/** Finds the first matching site in [from, to) a run at a time, skipping
+ *  runs of other kinds and full runs whole. Only runs with some sites
+ *  full and some open have their bitsets searched.
+ *
+ * @param path The game path
+ * @param kinds The KIND_BIT()s of the site kinds to match
+ * @param openOnly Whether to only match sites with room for another player
+ * @param from The first site to check, a site on the path
+ * @param to One past the last site to check, after from
+ * @return The ID of the first matching site, or -1 if there is none.
+ */
+static int find_site_in_runs(Path *path, unsigned int kinds, bool openOnly,
+        int from, int to) {
+    for (int runNum = find_run(path, from); runNum < path->numRuns &&
+            path->runs[runNum].start < to; ++runNum) {
+        SiteRun *run = &path->runs[runNum];
+        int first = run->start > from ? run->start : from;
+        int end = run->start + run->length < to ?
+                run->start + run->length : to;
+
+        if ((kinds & KIND_BIT(run->kind)) == 0 ||
+                (openOnly && run->fullSites == run->length)) {
+            continue;
+        }
+        if (!openOnly || run->fullSites == 0) {
+            return first;
+        }
+        int siteID = find_site_in_bitsets(path, kinds, true, first, end);
+        if (siteID != -1) {
+            return siteID;
+        }
+    }
+    return -1;
+}
+
+/** Finds the first site in [from, to) whose kind is in the given set of
+ *  kinds, by runs on paths made of long runs and otherwise a word of the
+ *  bitsets at a time.
+ *
+ * @param path The game path
+ * @param kinds The KIND_BIT()s of the site kinds to match
+ * @param openOnly Whether to only match sites with room for another player
+ * @param from The first site to check
+ * @param to One past the last site to check
+ * @return The ID of the first matching site, or -1 if there is none.
+ */
+int find_site(Path *path, unsigned int kinds, bool openOnly, int from,
+        int to) {
+    if (to > path->size) {
+        to = path->size;
+    }
+    if (from < 0) {
+        from = 0;
+    }
+    if (from >= to) {
+        return -1;
+    }
+    if (path->scanRuns) {
+        return find_site_in_runs(path, kinds, openOnly, from, to);
+    }
+    return find_site_in_bitsets(path, kinds, openOnly, from, to);
+}
+
+/** Makes a path with room for the given number of sites, which are left
+ *  for the caller to fill in.
+ *
+ * @param size The number of sites
+ * @return The path, with no players
+ */
+Path *new_path(int size) {
+    Path *path = malloc(sizeof(Path));
+    path->size = size;
+    path->sites = malloc(sizeof(Site) * size);
+    path->playersInGame = 0;
+    path->players = NULL;
+    path->deck = NULL;
+    path->totalCards = 0;
+    path->mostCards = 0;
+    path->mostCardsHolders = 0;
+    path->mirror = NULL;
+    path->speculation.valid = false;
+    path->nextMove = NULL;
+    path->broadcast = NULL;
+    path->spectators = NULL;
+    path->log = stdout;
+    path->transcript = NULL;
+    path->stats = NULL;
+    path->programs = NULL;
+    path->usage = NULL;
+    path->runs = NULL;
+    path->numRuns = 0;
+    return path;
+}
+
 /** Allocates the path from the given string.
  *
  * @param line The contents of the path file
@@ -41,50 +323,75 @@ int check_player_args(int argc, char **argv) {
  * @return The game path
  */
 Path *allocate_path(char *line, int numPlayers) {
-    Path *path = malloc(sizeof(Path));
-
     // get number of stops
-    // following is to find how many stops we have
-    char temp[] = ";";
-    char *trash;
-    int i = (int) strcspn(line, temp);
-
-    char numOfSites[5];
-    snprintf(numOfSites, i + 1, "%s", &line[0]);
-
-    int numberOfStops = (int) strtol(numOfSites, &trash, 10);
-    path->size = numberOfStops;
+    const char *site;
+    int numberOfStops = read_site_count(line, &site);
+    Path *path = new_path(numberOfStops);
 
-    // make a list of sites with length of the number of stops
-    Site *sites = malloc(sizeof(Site) * path->size);
+    bool fixedWidth = strlen(site) == SITE_WIDTH * (size_t) numberOfStops;
 
     for (int siteNum = 0; siteNum < numberOfStops; ++siteNum) {
-        // break up into each site
-
-        // already checked first few chars
-        char string[4];
-        snprintf(string, 4, "%s", &line[strlen(numOfSites) + 1 + 3 * siteNum]);
-
         // get site type and its value
-
-        // 4th is a number
         char type[3];
-        snprintf(type, 3, "%s", string);
-        sites[siteNum].type = malloc(sizeof(char) * 3);
-        strcpy(sites[siteNum].type, type);
+        int capacity;
+        site = next_site(site, fixedWidth, type, &capacity);
+        fill_site(path, siteNum, type, capacity == 0 ? numPlayers :
+                capacity);
+    }
 
-        if (strcmp(sites[siteNum].type, "::") == 0) {
-            sites[siteNum].playerLimit = numPlayers;
-        } else {
-            sites[siteNum].playerLimit = string[2] - '0';
-        }
+    allocate_site_bitsets(path);
+    return path;
+}
+
+/** Makes a path from sites which have already been validated, with no
+ *  parsing.
+ *
+ * @param compiledSites The sites, as laid out in a compiled path file
+ * @param size The number of sites
+ * @param numPlayers The number of players, which every barrier can hold
+ * @return The path
+ */
+Path *allocate_compiled_path(const CompiledSite *compiledSites, int size,
+        int numPlayers) {
+    Path *path = new_path(size);
+
+    for (int siteNum = 0; siteNum < size; ++siteNum) {
+        const CompiledSite *compiled = &compiledSites[siteNum];
+        char type[3] = {compiled->type[0], compiled->type[1], '\0'};
+        fill_site(path, siteNum, type, compiled->capacity == 0 ?
+                numPlayers : compiled->capacity);
     }
 
-    path->sites = sites;
-    path->playersInGame = 0;
+    allocate_site_bitsets(path);
     return path;
 }
 
+/** Frees a path and its players, for processes which play more than one
+ *  game. The deck and anything the dealer attached are left alone.
+ *
+ * @param path The game path
+ */
+void free_path(Path *path) {
+    for (int siteNum = 0; siteNum < path->size; ++siteNum) {
+        free(path->sites[siteNum].occupants);
+    }
+    for (int runNum = 0; runNum < path->numRuns; ++runNum) {
+        free(path->sites[path->runs[runNum].start].type);
+    }
+    free(path->runs);
+    free(path->sites);
+    free(path->openSites);
+    for (int kind = 0; kind < NUM_SITE_KINDS; ++kind) {
+        free(path->siteKinds[kind]);
+    }
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        free(path->players[playerId]->cards);
+        free(path->players[playerId]);
+    }
+    free(path->players);
+    free(path);
+}
+
 /** Prints the player details to stdout.
  *
  * @param path The game path
@@ -114,94 +421,144 @@ void path_exit(ProcessType processType) {
     player_exit(PATH_ERROR);
 }
 
-/** Checks if maps args are valid.
+/** Returns true if the sites of a path file are valid where some have
+ *  capacities of more than one digit.
+ *
+ * @param sites The sites of the path file, after the ';'
+ * @param numberOfStops The number of sites there should be
+ * @return true if there are that many valid sites, starting and ending
+ * with a barrier
+ */
+bool wide_sites_valid(const char *sites, int numberOfStops) {
+    if (numberOfStops < 2) {
+        return false;
+    }
+    const char *site = sites;
+    const char *lastSite = sites;
+    for (int siteNum = 0; siteNum < numberOfStops; ++siteNum) {
+        int capacity;
+        lastSite = site;
+        site = read_wide_site(site, &capacity);
+        if (site == NULL) {
+            return false;
+        }
+    }
+    return *site == '\0' && strncmp(sites, BARRIER, 2) == 0 &&
+            strncmp(lastSite, BARRIER, 2) == 0;
+}
+
+/** Reads the type and capacity of the next site of a valid path line.
+ *
+ * @param site The start of the site
+ * @param fixedWidth true if every site on the line is SITE_WIDTH characters
+ * @param type Set to the site's type
+ * @param capacity Set to the site's capacity, or 0 for a barrier
+ * @return The start of the next site
+ */
+const char *next_site(const char *site, bool fixedWidth, char type[3],
+        int *capacity) {
+    type[0] = site[0];
+    type[1] = site[1];
+    type[2] = '\0';
+    if (!fixedWidth) {
+        return read_wide_site(site, capacity);
+    }
+    *capacity = strcmp(type, BARRIER) == 0 ? 0 : site[2] - '0';
+    return site + SITE_WIDTH;
+}
+
+/** Reads the number of sites at the start of a path line.
+ *
+ * @param line The path line
+ * @param sites Set to the first site, just after the ';'
+ * @return The number of sites, or -1 if the line does not start with a
+ * number followed by ';' or the number is more than the line could hold.
+ */
+int read_site_count(const char *line, const char **sites) {
+    char *end;
+    long count = strtol(line, &end, 10);
+    if (end == line || *end != ';' || count < 0 ||
+            count > (long) (strlen(end) / SITE_WIDTH)) {
+        return -1;
+    }
+    *sites = end + 1;
+    return (int) count;
+}
+
+/** Returns true if the map's number of sites and length are valid.
  *
  * @param numberOfStops The number of stops on the path
- * @param processType The process type, either player or dealer
  * @param line The contents of the map file
- * @param numOfSites The number of sites
+ * @param sites The first site on the line
+ * @return true if the map args are valid
  */
-void check_map_args(int numberOfStops, ProcessType processType, char *line,
-        char *numOfSites) {
+bool map_args_valid(int numberOfStops, char *line, const char *sites) {
     if (numberOfStops < 2) {
-        path_exit(processType);
+        return false;
     }
 
     // check file length is correct
-    if (strlen(line) != 3 * numberOfStops + 1 + strlen(numOfSites)) {
-        path_exit(processType);
+    if (strlen(line) != 3 * (size_t) numberOfStops + (sites - line)) {
+        return false;
     }
+    return true;
 }
 
-
-/** Checks if the map file is valid.
+/** Returns true if the map file is valid, without exiting.
  *
  * @param line The contents of the map file
- * @param processType The type of the process, either player or dealer
- * @return NO_ERROR on success
+ * @return true if the map file is valid
  */
-int check_map_file(char *line, ProcessType processType) {
+bool map_file_valid(char *line) {
     // get number of stops
-    char temp[] = ";";
-    char *trash;
-    int i = (int) strcspn(line, temp);
-    char numOfSites[5];
-    snprintf(numOfSites, i + 1, "%s", &line[0]);
+    const char *sites;
+    int numberOfStops = read_site_count(line, &sites);
+    if (numberOfStops == -1) {
+        return false;
+    }
     // check number of sites is more than 2
-    int numberOfStops = (int) strtol(numOfSites, &trash, 10);
-    check_map_args(numberOfStops, processType, line, numOfSites);
-    char *validTypes = "Mo V1 V2 Do Ri ::";
-    char *validCapacity = "123456789";
-    // check each site
-    for (int siteNum = 0; siteNum < numberOfStops; ++siteNum) {
-        // get entire site
-        char site[4];
-        snprintf(site, 4, "%s", &line[strlen(numOfSites) + 1 + 3 * siteNum]);
-        // get site characters
-        char type[3];
-        snprintf(type, 3, "%s", site);
-        // if not valid type
-        if (strstr(validTypes, type) == NULL) {
-            path_exit(processType);
-        }
-        // checking capacities
-        if (strcmp(type, "::") == 0) {
-            // needs to be -
-            char dash[2];
-            snprintf(dash, 2, "%s", &site[2]);
-
-            if (strcmp(dash, "-") != 0) {
-                path_exit(processType);
-            }
-        } else {
-            // is normal site
-            char str[2] = "\0";
-            str[0] = site[2];
-            if (strstr(validCapacity, str) == NULL) {
-                path_exit(processType);
-            }
-        }
-        // first and last site need to be barriers
-        if (siteNum == 0 || siteNum == numberOfStops - 1) {
-            if (strcmp(type, "::") != 0) {
-                path_exit(processType);
-            }
-        }
+    if (!map_args_valid(numberOfStops, line, sites)) {
+        // capacities of more than one digit make the line longer
+        return wide_sites_valid(sites, numberOfStops);
     }
-    return NO_ERROR;
+    // check each site's type and capacity
+    if (first_invalid_site(sites, numberOfStops) != -1) {
+        return false;
+    }
+    // first and last site need to be barriers
+    const char *lastSite = &sites[SITE_WIDTH * (numberOfStops - 1)];
+    if (strncmp(sites, BARRIER, 2) != 0 ||
+            strncmp(lastSite, BARRIER, 2) != 0) {
+        return false;
+    }
+    return true;
 }
 
-/** Matches a comma in line at the given location.
+/** Returns true if the whole of a path file is valid: its first line is a
+ *  valid path and it does not go on to a blank line.
  *
- * @param line The HAP message
- * @param location The location to match the comma
+ * @param contents The contents of the path file
+ * @param line The first line of the contents
+ * @return true if the dealer would accept the path file
  */
-void match_comma(char *line, int location) {
-    char read[3];
-    snprintf(read, 2, "%s", &line[location]);
-    if (strcmp(read, ",") != 0) {
-        player_exit(PLAYER_COMMUNICATION_ERROR);
+bool path_contents_valid(char *contents, char *line) {
+    size_t lineLength = strcspn(contents, "\n");
+    bool blankNext = contents[lineLength] == '\n' &&
+            contents[lineLength + 1] == '\n';
+    return map_file_valid(line) && !blankNext;
+}
+
+/** Checks if the map file is valid.
+ *
+ * @param line The contents of the map file
+ * @param processType The type of the process, either player or dealer
+ * @return NO_ERROR on success
+ */
+int check_map_file(char *line, ProcessType processType) {
+    if (!map_file_valid(line)) {
+        path_exit(processType);
     }
+    return NO_ERROR;
 }
 
 /** Does associated things with a YT message.
@@ -213,131 +570,124 @@ void match_comma(char *line, int location) {
  * @return 0 on success.
  */
 int do_message_yt(char *line, Path *path, int playerId, char playerType) {
-    int move = 0;
-    if (playerType == 'A') {
-        move = player_a_next_move(path, playerId);
-    } else if (playerType == 'B') {
-        move = player_b_next_move(path, playerId);
+    Speculation *speculation = &path->speculation;
+    if (path->mirror != NULL) {
+        read_mirror(path->mirror, path);
+    }
+    // the move is normally worked out when the last HAP comes in
+    if (!speculation->valid) {
+        work_out_move(path, playerId, playerType);
     }
 
-    fprintf(stdout, "DO%d\n", path->players[playerId]->siteNumber + move);
+    TRACE_BEGIN("do_write", playerId);
+    fwrite(speculation->reply, 1, speculation->replyLength, stdout);
     fflush(stdout);
+    TRACE_END("do_write", playerId);
+    speculation->valid = false;
 
     return 0;
 }
 
-/** Matches the playerID in a HAP message.
- *
- * @param path The path
- * @param line The HAP message
- * @return The player ID in the HAP message.
- */
-int match_player_id(Path *path, char *line) {
-    char *trash;
-    char subString[5];
-    char *validIDs = "0123456789";
-
-    snprintf(subString, 2, "%s", &line[3]);
-    if (strstr(validIDs, subString) == NULL) {
-        player_exit(PLAYER_COMMUNICATION_ERROR);
-    }
-    int newMovePlayerID = (int) strtol(subString, &trash, 10);
-    if (newMovePlayerID > path->playersInGame - 1) {
-        player_exit(PLAYER_COMMUNICATION_ERROR);
-    }
-
-    return newMovePlayerID;
-}
-
-/** Matches the site in a HAP message.
+/** Works out the player's move from where things are now and keeps the
+ *  reply to it.
  *
- * @param path The path
- * @param line The HAP message
- * @return The site in the HAP message
+ * @param path The game path
+ * @param playerId The player's ID
+ * @param playerType The player Type, either A or B
  */
-int match_site(Path *path, char *line) {
-    char *trash;
-    char subString[5];
-    // get the site number
-    snprintf(subString, 5, "%s", &line[5]);
-    int newMoveSiteID = (int) strtol(subString, &trash, 10);
-
-    // received invalid move
-    if (newMoveSiteID > path->size) {
-        player_exit(PLAYER_COMMUNICATION_ERROR);
+void work_out_move(Path *path, int playerId, char playerType) {
+    Speculation *speculation = &path->speculation;
+    int move = 0;
+    TRACE_BEGIN("strategy", playerId);
+    if (path->nextMove != NULL) {
+        move = path->nextMove(path, playerId);
+    } else if (playerType == 'A') {
+        move = player_a_next_move(path, playerId);
+    } else if (playerType == 'B') {
+        move = player_b_next_move(path, playerId);
     }
+    TRACE_END("strategy", playerId);
 
-    // returns the padding following functions need to add
-    return newMoveSiteID;
+    int siteNumber = path->players[playerId]->siteNumber;
+    speculation->valid = true;
+    speculation->playerId = playerId;
+    speculation->lastSite = find_next_barrier(path, siteNumber);
+    speculation->replyLength = snprintf(speculation->reply,
+            sizeof(speculation->reply), "DO%d\n", siteNumber + move);
 }
 
-/** Matches the points in a HAP message.
+/** Works out the player's move ahead of YT if it is their turn next, so
+ *  that the reply is ready when YT comes. Does nothing if a move is
+ *  already worked out, or the game is over.
  *
  * @param path The game path
- * @param line The HAP message
- * @param padding The padding to be added to subsequent print calls
- * @return The points in the HAP message
+ * @param playerId The player's ID
+ * @param playerType The player Type, either A or B
  */
-int match_points(Path *path, char *line, int padding) {
-    char *trash;
-    char subString[5];
-    char *validIDs = "0123456789";
-
-    snprintf(subString, 5, "%s", &line[7 + padding]);
-
-    for (int i = 0; i < strlen(subString); ++i) {
-        char p[2] = "\0";
-        p[0] = subString[i];
-        if (subString[i] == ',') {
-            break;
-        }
-        if (strstr(validIDs, p) == NULL) {
-            player_exit(PLAYER_COMMUNICATION_ERROR);
-        }
+void speculate_move(Path *path, int playerId, char playerType) {
+    if (!path->speculation.valid && check_game_over(path) != 0 &&
+            next_player_to_move(path) == playerId) {
+        work_out_move(path, playerId, playerType);
     }
-
-    // get additional points for player
-    return (int) strtol(subString, &trash, 10);
-
 }
 
-/** Matches the money in a HAP message.
+/** Drops the worked out move if a HAP about to be applied could change
+ *  it.
  *
- * @param line The message
- * @param padding The padding to be added to subsequent print calls
- * @return The money of the HAP message
+ * @param path The game path, before the HAP is applied
+ * @param moverId The player who moved
+ * @param siteId The site they moved to
+ * @param card The card they drew, or 0
  */
-int match_money(char *line, int padding) {
-    char *trash;
-    char subString[5];
-    // get change in money for player
-    snprintf(subString, 5, "%s", &line[9 + padding]);
-    int newMoveMoney = (int) strtol(subString, &trash, 10);
-
-    return newMoveMoney;
+void forget_speculation(Path *path, int moverId, int siteId, int card) {
+    Speculation *speculation = &path->speculation;
+    int oldSite = path->players[moverId]->siteNumber;
+    if (moverId == speculation->playerId || card != 0 ||
+            oldSite <= speculation->lastSite ||
+            siteId <= speculation->lastSite) {
+        speculation->valid = false;
+    }
 }
 
-/** Matches the card in a HAP message.
+/** Reads one field of a HAP message in place: a decimal integer in the
+ *  given range followed by the given character.
  *
- * @param line The message
- * @param padding The padding to be added to subsequent print calls
- * @return The card in the HAP message
+ * @param cursor The start of the field; moved past its terminator
+ * @param min The smallest value allowed. A '-' is only accepted below 0.
+ * @param max The largest value allowed
+ * @param end The character which must follow the digits
+ * @return The value of the field. Exits with a communication error if the
+ * field is empty, out of range or not followed by end.
  */
-int match_card(char *line, int padding) {
-    char *trash;
-    char subString[5];
-    // get the card drawn by player.
-    snprintf(subString, 2, "%s", &line[11 + padding]);
-    int newMoveCardDrawn = (int) strtol(subString, &trash, 10);
-
-    if (newMoveCardDrawn > 5 || newMoveCardDrawn < 0) {
+int scan_hap_field(const char **cursor, long long min, long long max,
+        char end) {
+    const char *at = *cursor;
+    bool negative = false;
+    if (*at == '-' && min < 0) {
+        negative = true;
+        ++at;
+    }
+    if (*at < '0' || *at > '9') {
         player_exit(PLAYER_COMMUNICATION_ERROR);
     }
-    // check if any more to the line
-    if (line[12 + padding] != '\0') {
+
+    long long value = 0;
+    for (; *at >= '0' && *at <= '9'; ++at) {
+        value = value * 10 + (*at - '0');
+        // stop before the value can overflow
+        if (value > max - (min < 0 ? min : 0)) {
+            player_exit(PLAYER_COMMUNICATION_ERROR);
+        }
+    }
+    if (negative) {
+        value = -value;
+    }
+    if (value < min || value > max || *at != end) {
         player_exit(PLAYER_COMMUNICATION_ERROR);
     }
-    return newMoveCardDrawn;
+
+    *cursor = at + 1;
+    return (int) value;
 }
 
 /** Do V1 and V2 actions.
@@ -357,54 +707,60 @@ void site_v1_v2(Player *player, Site *site) {
 }
 
 
-/** Performs the associated HAP message on the player.
+/** Performs the associated HAP message on the player. The message is
+ *  HAP<id>,<site>,<points>,<money>,<card> and is read in one pass without
+ *  copying; anything else is a communication error.
  *
- * @param line The line
- * @param path
- * @param playerID
- * @param playerType
+ * @param line The line, starting with "HAP"
+ * @param path The game path
  * @return 0 if successful.
  */
 int do_hap(char *line, Path *path) {
-    int padding = 0;
-
-    // get details from HAP
-    int newMovePlayerID = match_player_id(path, line);
-    match_comma(line, 4);
+    const char *cursor = &line[3];
 
-    int newMoveSiteID = match_site(path, line);
-    padding += count_chars(newMoveSiteID) - 1;
-    match_comma(line, 6 + padding);
+    int newMovePlayerID = scan_hap_field(&cursor, 0,
+            path->playersInGame - 1, ',');
+    int newMoveSiteID = scan_hap_field(&cursor, 0, path->size - 1, ',');
+    int newMovePoints = scan_hap_field(&cursor, 0, INT_MAX, ',');
+    int newMoveMoney = scan_hap_field(&cursor, INT_MIN, INT_MAX, ',');
+    int newMoveCardDrawn = scan_hap_field(&cursor, 0, NUM_CARDS, '\0');
 
-    int newMovePoints = match_points(path, line, padding);
-    padding += count_chars(newMovePoints) - 1;
-    match_comma(line, 8 + padding);
+    forget_speculation(path, newMovePlayerID, newMoveSiteID,
+            newMoveCardDrawn);
+    apply_hap(path, newMovePlayerID, newMoveSiteID, newMovePoints,
+            newMoveMoney, newMoveCardDrawn);
 
-    int newMoveMoney = match_money(line, padding);
-    padding += count_chars(newMoveMoney) - 1;
-    match_comma(line, 10 + padding);
+    print_player_details(path, newMovePlayerID, path->log);
 
-    int newMoveCardDrawn = match_card(line, padding);
+    return 0;
+}
 
-    Player *player = path->players[newMovePlayerID];
+/** Applies a move the dealer has reported to the path.
+ *
+ * @param path The game path
+ * @param playerId The player who moved
+ * @param siteId The site the player moved to
+ * @param points The player's change in points
+ * @param money The player's change in money
+ * @param card The card the player drew, 1 for A to 5 for E, or 0
+ */
+void apply_hap(Path *path, int playerId, int siteId, int points, int money,
+        int card) {
+    Player *player = path->players[playerId];
 
-    int steps = newMoveSiteID - player->siteNumber;
-    move_player(path, newMovePlayerID, steps, PLAYER);
+    int steps = siteId - player->siteNumber;
+    move_player(path, playerId, steps, PLAYER);
 
     Site *site = &path->sites[player->siteNumber];
     site_v1_v2(player, site);
 
-    player->points += newMovePoints;
-    player->money += newMoveMoney;
+    player->points += points;
+    player->money += money;
 
     // add card to player's cards
-    if (newMoveCardDrawn > 0) {
-        player->cards[newMoveCardDrawn - 1] += 1;
+    if (card > 0) {
+        give_card(path, player, card - 1);
     }
-
-    print_player_details(path, newMovePlayerID, stderr);
-
-    return 0;
 }
 
 /** Checks the dealer response and acts accordingly.
@@ -416,29 +772,41 @@ int do_hap(char *line, Path *path) {
  * @return 0 if successful, 1 otherwise
  */
 int check_input(char *line, Path *path, int playerId, char playerType) {
-    if (strcmp(line, "YT") == 0) {
-        do_message_yt(line, path, playerId, playerType);
-        return 0;
-    }
-
-    if (strcmp(line, "EARLY") == 0) {
-        player_exit(EARLY_GAME_OVER);
-        return 0;
-    }
-
-    if (strcmp(line, "DONE") == 0) {
-        game_over(path, stderr);
-        player_exit(NO_ERROR_PLAYER);
-        return 0;
-    }
-
-    // need to check first 3 characters
-    char read[4];
-    snprintf(read, 4, "%s", &line[0]);
-
-    if (strcmp(read, "HAP") == 0) {
-        do_hap(line, path);
-        return 0;
+    // every message is told apart by its first byte
+    switch (line[0]) {
+        case 'Y':
+            if (strcmp(line, "YT") == 0) {
+                do_message_yt(line, path, playerId, playerType);
+                return 0;
+            }
+            break;
+        case 'E':
+            if (strcmp(line, "EARLY") == 0) {
+                player_exit(EARLY_GAME_OVER);
+                return 0;
+            }
+            break;
+        case 'D':
+            if (strcmp(line, "DONE") == 0) {
+                if (path->mirror != NULL) {
+                    read_mirror(path->mirror, path);
+                }
+                game_over(path, path->log);
+                player_exit(NO_ERROR_PLAYER);
+                return 0;
+            }
+            break;
+        case 'H':
+            if (line[1] == 'A' && line[2] == 'P') {
+                // with a mirror the move is still checked and shown, but
+                // the player's turn is worked out from the shared state
+                do_hap(line, path);
+                if (path->mirror == NULL) {
+                    speculate_move(path, playerId, playerType);
+                }
+                return 0;
+            }
+            break;
     }
 
     return 1;
@@ -462,17 +830,30 @@ void sig_handler(int signal) {
  * @param playerType The type of the process - either Dealer or Player
  */
 void start_player(int numPlayers, int id, Path *path, char playerType) {
-    print_path(path, stderr);
-    fflush(stderr);
+    path->mirror = attach_mirror(path);
+    path->log = open_log(stderr);
+    char processName[32];
+    snprintf(processName, sizeof(processName), "player %d (%c)", id,
+            playerType);
+    start_trace(processName);
+    print_path(path, path->log);
+    fflush(path->log);
+    if (path->mirror == NULL) {
+        speculate_move(path, id, playerType);
+    }
     while (true) {
         // wait for dealer input
+        TRACE_BEGIN("read_input", id);
         char *input = read_line(stdin);
+        TRACE_END("read_input", id);
         if (strcmp(input, "\a") == 0) {
             player_exit(PLAYER_COMMUNICATION_ERROR);
         }
+        TRACE_BEGIN("check_input", id);
         if (check_input(input, path, id, playerType)) {
             player_exit(PLAYER_COMMUNICATION_ERROR);
         }
+        TRACE_END("check_input", id);
     }
 }
 
@@ -517,10 +898,10 @@ int check_game_over(Path *path) {
  * @return The ID of the next barrier site.
  */
 int find_next_barrier(Path *path, int currentSiteID) {
-    for (int siteID = currentSiteID + 1; siteID < path->size; ++siteID) {
-        if (strcmp(path->sites[siteID].type, BARRIER) == 0) {
-            return siteID;
-        }
+    int siteID = find_site(path, KIND_BIT(SITE_BARRIER), false,
+            currentSiteID + 1, path->size);
+    if (siteID != -1) {
+        return siteID;
     }
 
     // if we get here then there are no more barriers, eg we are at end
@@ -559,15 +940,11 @@ int check_if_last_player(Path *path, Player *player) {
  *  **/
 int check_before_barrier(Path *path, Player *player, char *siteType) {
     int nextBarrierID = find_next_barrier(path, player->siteNumber);
-    Site *sites = path->sites;
+    int siteID = find_site(path, KIND_BIT(site_kind(siteType)), true,
+            player->siteNumber + 1, nextBarrierID);
 
-    for (int siteID = player->siteNumber + 1; siteID < nextBarrierID;
-            ++siteID) {
-        if (strcmp(sites[siteID].type, siteType) == 0) {
-            if (available(sites[siteID]) == 0) {
-                return siteID - player->siteNumber;
-            }
-        }
+    if (siteID != -1) {
+        return siteID - player->siteNumber;
     }
     return -1;
 }
@@ -578,16 +955,53 @@ int check_before_barrier(Path *path, Player *player, char *siteType) {
  * @return The number of cards the player has.
  */
 int sum_cards(Player *player) {
-    int *playerCards = player->cards;
-    int total = 0;
+    return player->cardTotal;
+}
 
-    total += playerCards[A];
-    total += playerCards[B];
-    total += playerCards[C];
-    total += playerCards[D];
-    total += playerCards[E];
+/** Gives a player a card and updates the path's card totals.
+ *
+ * @param path The game path
+ * @param player The player drawing the card
+ * @param suit The card, A to E
+ */
+void give_card(Path *path, Player *player, int suit) {
+    player->cards[suit] += 1;
+    player->cardTotal += 1;
+    path->totalCards += 1;
+
+    // totals only go up, so the player either joins or passes the leaders
+    if (player->cardTotal > path->mostCards) {
+        path->mostCards = player->cardTotal;
+        path->mostCardsHolders = 1;
+    } else if (player->cardTotal == path->mostCards) {
+        path->mostCardsHolders += 1;
+    }
+}
 
-    return total;
+/** Works out every card total again, for when the players' cards have
+ *  been replaced rather than added to.
+ *
+ * @param path The game path
+ */
+void recount_cards(Path *path) {
+    path->totalCards = 0;
+    path->mostCards = 0;
+    path->mostCardsHolders = 0;
+    for (int playerID = 0; playerID < path->playersInGame; ++playerID) {
+        Player *player = path->players[playerID];
+        int *cards = player->cards;
+        player->cardTotal = cards[A] + cards[B] + cards[C] + cards[D] +
+                cards[E];
+        path->totalCards += player->cardTotal;
+
+        if (player->cardTotal > path->mostCards ||
+                path->mostCardsHolders == 0) {
+            path->mostCards = player->cardTotal;
+            path->mostCardsHolders = 1;
+        } else if (player->cardTotal == path->mostCards) {
+            path->mostCardsHolders += 1;
+        }
+    }
 }
 
 /** Returns 0 if the given player has the most cards of all players.
@@ -597,14 +1011,12 @@ int sum_cards(Player *player) {
  * @return 0 if the player has the most cards, otherwise, 1
  */
 int check_if_most_cards(Path *path, Player *player) {
-    for (int playerID = 0; playerID < path->playersInGame; ++playerID) {
-        if (sum_cards(path->players[playerID]) >= sum_cards(player)) {
-            if (playerID != player->id) {
-                return 1;
-            }
-        }
+    // only the player holds the most cards
+    if (player->cardTotal == path->mostCards &&
+            path->mostCardsHolders == 1) {
+        return 0;
     }
-    return 0;
+    return 1;
 }
 
 /** Returns 0 if everyone has zero cards.
@@ -613,13 +1025,7 @@ int check_if_most_cards(Path *path, Player *player) {
  * @return 0 if all players have zero cards, or 1 otherwise.
  */
 int check_empty_cards(Path *path) {
-    Player **players = path->players;
-    for (int playerID = 0; playerID < path->playersInGame; ++playerID) {
-        if (sum_cards(players[playerID]) != 0) {
-            return 1;
-        }
-    }
-    return 0;
+    return path->totalCards != 0;
 }
 
 /** Finds the earliest site which is available.
@@ -629,11 +1035,10 @@ int check_empty_cards(Path *path) {
  * @return The ID of the next available site.
  */
 int find_earliest(Path *path, int currentSiteID) {
-    for (int siteID = currentSiteID + 1; siteID < path->size; ++siteID) {
-        if (path->sites[siteID].numPlayersCurrently <
-                path->sites[siteID].playerLimit) {
-            return siteID;
-        }
+    int siteID = find_site(path, ALL_SITE_KINDS, true, currentSiteID + 1,
+            path->size);
+    if (siteID != -1) {
+        return siteID;
     }
     // shouldn't be able to get here
     return 1;
@@ -757,6 +1162,20 @@ int calculate_total_score(Player *player) {
     return totalScore;
 }
 
+/** Returns the player's score without using up their cards, so it can be
+ *  taken before game_over.
+ *
+ * @param player The player
+ * @return The score game_over would print
+ */
+int final_score(Player *player) {
+    Player copy = *player;
+    int cards[NUM_CARDS];
+    memcpy(cards, player->cards, sizeof(cards));
+    copy.cards = cards;
+    return calculate_total_score(&copy);
+}
+
 /** Returns 0 if a site is available to move to.
  *
  * @param site The site to be checked
@@ -797,43 +1216,58 @@ int player_a_next_move(Path *path, int playerId) {
     }
 
     // pick the closest V1, V2 or Barrier and go there
-    for (int siteId = player->siteNumber + 1; siteId <= nextBarrierID;
-            ++siteId) {
-        if (available(sites[siteId]) == 0) {
-            if (strcmp(sites[siteId].type, V1) == 0) {
-                return siteId - player->siteNumber;
-            }
-            if (strcmp(sites[siteId].type, V2) == 0) {
-                return siteId - player->siteNumber;
-            }
-            if (strcmp(sites[siteId].type, BARRIER) == 0) {
-                return siteId - player->siteNumber;
-            }
-        }
-
+    int siteId = find_site(path, KIND_BIT(SITE_V1) | KIND_BIT(SITE_V2) |
+            KIND_BIT(SITE_BARRIER), true, player->siteNumber + 1,
+            nextBarrierID + 1);
+    if (siteId != -1) {
+        return siteId - player->siteNumber;
     }
     // shouldnt be able to get here
     return -1;
 }
 
 
-/** Prints the sites and returns the number of lines required to
- *  display the board.
+/** Returns how many characters wide each site's column of the board is:
+ *  wide enough for the largest player ID and a space, and never less than
+ *  a site.
+ *
+ * @param path The game path
+ * @return The width of each column
+ */
+int column_width(Path *path) {
+    int width = 1;
+    for (int id = path->playersInGame - 1; id >= 10; id /= 10) {
+        width += 1;
+    }
+    return width + 1 > SITE_WIDTH ? width + 1 : SITE_WIDTH;
+}
+
+/** Prints the sites, a run at a time, and returns the number of lines
+ *  required to display the board.
  *
  * @param path The game path
  * @param location The filestream to write to
+ * @param width The width of each site's column
  * @return The number of lines required for print_path()
  */
-int print_path_find_lines(Path *path, FILE *location) {
+int print_path_find_lines(Path *path, FILE *location, int width) {
+    char column[width + 1];
+    for (int runNum = 0; runNum < path->numRuns; ++runNum) {
+        SiteRun *run = &path->runs[runNum];
+        snprintf(column, sizeof(column), "%-*s", width,
+                path->sites[run->start].type);
+        for (int site = 0; site < run->length; ++site) {
+            fputs(column, location);
+        }
+    }
+    fflush(location);
+
+    // find out how many lines we need to display
     int numLines = 0;
-    for (int sitenum = 0; sitenum < path->size; ++sitenum) {
-        Site site = path->sites[sitenum];
-        fprintf(location, "%s ", site.type);
-        fflush(location);
-
-        // find out how many lines we need to display
-        if (site.numPlayersCurrently > numLines) {
-            numLines = site.numPlayersCurrently;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        Site *site = &path->sites[path->players[playerId]->siteNumber];
+        if (site->numPlayersCurrently > numLines) {
+            numLines = site->numPlayersCurrently;
         }
     }
 
@@ -848,41 +1282,42 @@ int print_path_find_lines(Path *path, FILE *location) {
  */
 void print_path(Path *path, FILE *location) {
     Player **players = path->players;
-    int numLines = print_path_find_lines(path, location);
-    char **lines = make_empty_strings(numLines, path->size);
-
-    // printing player positions below the path
-    for (int siteNumber = 0; siteNumber < path->size; ++siteNumber) {
+    int width = column_width(path);
+    int numLines = print_path_find_lines(path, location, width);
+    char **lines = make_empty_strings(numLines, path->size, width);
+
+    // printing player positions below the path, only visiting the sites
+    // with players, each from the player in its first slot
+    for (int firstId = 0; firstId < path->playersInGame; ++firstId) {
+        int siteNumber = players[firstId]->siteNumber;
         Site site = path->sites[siteNumber];
+        if (site.occupants[0] != firstId) {
+            continue;
+        }
 
-        int printed = 0;
         int lastPrintedPos = 0;
         int playerWithLowest = -1;
 
-        // need to loop through each player to find lowest position and print
-        while (printed < site.numPlayersCurrently) {
+        // print the site's players from lowest position, lowest ID first
+        for (int printed = 0; printed < site.numPlayersCurrently; ++printed) {
             int lowestPosition = 9999;
 
             // find positioning
-            for (int player = 0; player < path->playersInGame; ++player) {
-                if (players[player]->siteNumber == siteNumber) {
-                    if (players[player]->position < lowestPosition &&
-                            players[player]->position > lastPrintedPos) {
-                        lowestPosition = players[player]->position;
-                        playerWithLowest = player;
-                    }
+            for (int slot = 0; slot < site.numPlayersCurrently; ++slot) {
+                Player *player = players[site.occupants[slot]];
+                if (player->position > lastPrintedPos &&
+                        (player->position < lowestPosition ||
+                        (player->position == lowestPosition &&
+                        player->id < playerWithLowest))) {
+                    lowestPosition = player->position;
+                    playerWithLowest = player->id;
                 }
             }
 
-            for (int j = 0; j < numLines; ++j) {
-                // if the space hasn't been printed to
-                if (lines[j][3 * siteNumber] == ' ') {
-                    lines[j][3 * siteNumber] = playerWithLowest + '0';
-                    printed += 1;
-                    lastPrintedPos = lowestPosition;
-                    break;
-                }
-            }
+            char id[12];
+            int length = snprintf(id, sizeof(id), "%d", playerWithLowest);
+            memcpy(&lines[printed][width * siteNumber], id, length);
+            lastPrintedPos = lowestPosition;
         }
     }
 
@@ -895,6 +1330,54 @@ void print_path(Path *path, FILE *location) {
 }
 
 
+/** Empties the site's list of occupants.
+ *
+ * @param site The site
+ */
+void init_occupants(Site *site) {
+    site->occupants = NULL;
+    site->occupantSlots = 0;
+    site->numPlayersCurrently = 0;
+}
+
+/** Adds the player to the site's list of occupants, growing it if full.
+ *
+ * @param site The site the player has arrived at
+ * @param player The player
+ */
+static void add_occupant(Site *site, Player *player) {
+    if (site->numPlayersCurrently == site->occupantSlots) {
+        site->occupantSlots = site->occupantSlots == 0 ? 1 :
+                2 * site->occupantSlots;
+        site->occupants = realloc(site->occupants,
+                sizeof(int) * site->occupantSlots);
+    }
+    player->siteSlot = site->numPlayersCurrently;
+    site->occupants[site->numPlayersCurrently] = player->id;
+    site->numPlayersCurrently += 1;
+}
+
+/** Removes the player from the site's list of occupants by moving the
+ *  last occupant into their slot, shrinking the list once mostly empty.
+ *
+ * @param path The game path
+ * @param site The site the player is leaving
+ * @param player The player
+ */
+static void remove_occupant(Path *path, Site *site, Player *player) {
+    site->numPlayersCurrently -= 1;
+    int lastId = site->occupants[site->numPlayersCurrently];
+    site->occupants[player->siteSlot] = lastId;
+    path->players[lastId]->siteSlot = player->siteSlot;
+
+    if (site->occupantSlots > 4 &&
+            site->numPlayersCurrently < site->occupantSlots / 4) {
+        site->occupantSlots /= 2;
+        site->occupants = realloc(site->occupants,
+                sizeof(int) * site->occupantSlots);
+    }
+}
+
 /** Initialises and returns a player.
  *
  * @param path The game path
@@ -914,27 +1397,15 @@ Player *init_player(Path *path, int id) {
     int *cards = malloc(sizeof(int) * NUM_CARDS);
     memset(cards, 0, sizeof(int) * 5);
     player->cards = cards;
-
-    path->sites[0].numPlayersCurrently += 1;
-
-    // dynamically increase playerIDs array for each new player
-    for (int siteNum = 0; siteNum < path->size; ++siteNum) {
-        Site *site = &path->sites[siteNum];
-        if (path->playersInGame == 0) {
-            site->playerIDs = malloc(sizeof(int));
-        } else {
-            site->playerIDs = realloc(site->playerIDs,
-                    sizeof(int) * path->playersInGame + 1);
-        }
+    player->cardTotal = 0;
+    // everyone starts level on no cards
+    if (path->mostCards == 0) {
+        path->mostCardsHolders += 1;
     }
 
+    add_occupant(&path->sites[0], player);
+    update_open_site(path, 0);
     path->playersInGame += 1;
-
-    // ensure the player only exists at one site
-    for (int siteNum = 0; siteNum < path->size; ++siteNum) {
-        path->sites[siteNum].playerIDs[id] = 0;
-    }
-    path->sites[0].playerIDs[id] = 1;
     player->position = path->sites[0].numPlayersCurrently;
 
     return player;
@@ -961,16 +1432,18 @@ void arrange_order_of_players(Path *path) {
  * Return: The Id of the player with the highest score on the current site.
  */
 int get_highest_score(Path *path, int siteNum) {
+    Site *site = &path->sites[siteNum];
     int highestScore = 0;
     int playerIdwithHS = -1;
 
-    for (int i = 0; i < path->playersInGame; ++i) {
-        // if the player is at the site
-        if (path->players[i]->siteNumber == siteNum) {
-            if (path->players[i]->position > highestScore) {
-                highestScore = path->players[i]->position;
-                playerIdwithHS = i;
-            }
+    for (int slot = 0; slot < site->numPlayersCurrently; ++slot) {
+        Player *player = path->players[site->occupants[slot]];
+        // ties go to the lowest ID
+        if (player->position > highestScore ||
+                (player->position == highestScore && highestScore > 0 &&
+                player->id < playerIdwithHS)) {
+            highestScore = player->position;
+            playerIdwithHS = player->id;
         }
     }
 
@@ -996,33 +1469,16 @@ int next_player_to_move(Path *path) {
 
 /** Does action associated with landing on a Ri site.
  *
- * @param deck The deck of cards to draw from.
+ * @param path The game path, with the deck of cards to draw from.
  * @param player The player who landed on Ri site.
  * @return 1 for A, 2 for B, 3 for C, 4 for D, and 5 for E
  */
-int do_ri(Deck *deck, Player *player) {
-    Card *card = next_card(deck);
-    int *playerCards = player->cards;
+int do_ri(Path *path, Player *player) {
+    Card *card = next_card(path->deck);
 
-    if (card->value == 'A') {
-        playerCards[A] += 1;
-        return 1;
-    }
-    if (card->value == 'B') {
-        playerCards[B] += 1;
-        return 2;
-    }
-    if (card->value == 'C') {
-        playerCards[C] += 1;
-        return 3;
-    }
-    if (card->value == 'D') {
-        playerCards[D] += 1;
-        return 4;
-    }
-    if (card->value == 'E') {
-        playerCards[E] += 1;
-        return 5;
+    if (card->value >= 'A' && card->value <= 'E') {
+        give_card(path, player, card->value - 'A');
+        return card->value - 'A' + 1;
     }
     return 0;
 }
@@ -1061,7 +1517,7 @@ int do_action(Path *path, int playerId) {
     }
     // do Ri type
     if (strcmp(site->type, RI) == 0) {
-//        do_ri(path->deck, player);
+//        do_ri(path, player);
         return 0;
     }
     // barrier site, do nothing
@@ -1087,19 +1543,22 @@ void move_player(Path *path, int playerId, int steps,
     Player *player = path->players[playerId];
     Site *site = &(path->sites[player->siteNumber]);
     // remove from old site
-    site->numPlayersCurrently -= 1;
-    site->playerIDs[player->id] = 0;
+    remove_occupant(path, site, player);
+    update_open_site(path, player->siteNumber);
     player->siteNumber += steps;
 
     site = &(path->sites[player->siteNumber]);
     // move to new site
-    site->numPlayersCurrently += 1;
-    site->playerIDs[player->id] = 1;
+    add_occupant(site, player);
+    update_open_site(path, player->siteNumber);
 
     player->position = site->numPlayersCurrently;
 
     // do action
     if (processType == DEALER) {
+        if (path->stats != NULL) {
+            count_move(path->stats, player->siteNumber);
+        }
         do_action(path, playerId);
     }
 }
@@ -5,11 +5,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <limits.h>
 #include <signal.h>
 #include <unistd.h>
 #include "util.h"
 #include "deck.h"
+#include "validate.h"
+#include "mirror.h"
+#include "broadcast.h"
+#include "spectate.h"
+#include "logger.h"
+#include "transcript.h"
+#include "stats.h"
+#include "compiled.h"
+#include "usage.h"
+#include "trace.h"
 
 #define MO "Mo"
 #define V1 "V1"
@@ -18,6 +29,13 @@
 #define RI "Ri"
 #define BARRIER "::"
 #define NUM_CARDS 5
+// most players a game can have; IDs past 9 take more than one digit
+#define MAX_PLAYERS 999
+#define BITSET_WORD_BITS 64
+#define KIND_BIT(kind) (1u << (kind))
+#define ALL_SITE_KINDS ((1u << NUM_SITE_KINDS) - 1)
+// the average run length from which find_site walks runs
+#define RUN_SCAN_MIN_LENGTH 32
 
 
 /** Enumeration of a hand of cards.*/
@@ -29,6 +47,19 @@ typedef enum Cards {
     E
 } Cards;
 
+/** Enumeration of the kinds of site on a path. **/
+typedef enum SiteKind {
+    SITE_MO,
+    SITE_V1,
+    SITE_V2,
+    SITE_DO,
+    SITE_RI,
+    SITE_BARRIER,
+    // a type check_map_file accepts but which has no action, eg "o "
+    SITE_OTHER,
+    NUM_SITE_KINDS
+} SiteKind;
+
 /** Represents whether the process is a player or Dealer. **/
 typedef enum ProcessType {
     PLAYER = 0,
@@ -54,14 +85,18 @@ typedef struct Player {
     // the player's points
     int points;
 
-    // the cards the player has collected
+    // the cards the player has collected, and how many in all
     int *cards;
+    int cardTotal;
 
     // the players position relative to the rest of the players
     // eg for 5 players, 0 means the player is in the front
     // 4 means the player is last so their move is next
     int position;
 
+    // where the player is in their site's list of occupants
+    int siteSlot;
+
     // pipes containing file descriptors for communication
     int sendPipes[2];
     int receivePipes[2];
@@ -77,16 +112,49 @@ typedef struct Site {
     // type of site
     char *type;
 
+    // the kind of site, matching type
+    SiteKind kind;
+
     // max number of players the site can have
     int playerLimit;
 
-    // array of playerIDs.
-    int *playerIDs;
+    // the IDs of the players at the site, in no particular order. Only
+    // grown as far as the most players the site has held at once.
+    int *occupants;
+    int occupantSlots;
 
     // the number of players currently at the site
     int numPlayersCurrently;
 } Site;
 
+/** Consecutive sites of the same type and capacity, which share one type
+ *  string.
+ */
+typedef struct SiteRun {
+    int start;
+    int length;
+    SiteKind kind;
+
+    // how many of the run's sites have no room for another player
+    int fullSites;
+} SiteRun;
+
+/** A move worked out before the player's turn. It stays good until a HAP
+ *  changes the occupancy of a site up to the player's next barrier, moves
+ *  the player or deals a card.
+ */
+typedef struct Speculation {
+    bool valid;
+
+    // the player the move is for, and the last site the move depends on
+    int playerId;
+    int lastSite;
+
+    // the reply to send on YT
+    char reply[16];
+    int replyLength;
+} Speculation;
+
 /** Represents the game path.
  */
 typedef struct Path {
@@ -102,13 +170,74 @@ typedef struct Path {
     // array of player pointers
     Player **players;
 
+    // the cards held by all players, the most held by any one player and
+    // how many players hold that many; kept up to date by give_card
+    int totalCards;
+    int mostCards;
+    int mostCardsHolders;
+
+    // the number of 64-bit words in each site bitset
+    int bitsetWords;
+
+    // bit n is set when site n has room for another player
+    uint64_t *openSites;
+
+    // bit n of siteKinds[kind] is set when site n is of that kind
+    uint64_t *siteKinds[NUM_SITE_KINDS];
+
+    // the sites as runs, and whether find_site walks the runs rather than
+    // every word of the bitsets, which it does when runs are long
+    SiteRun *runs;
+    int numRuns;
+    bool scanRuns;
+
     // the deck of cards for which the dealer can deal.
     // Only dealer has access.
     Deck *deck;
+
+    // the dealer's shared game state, or NULL if players follow HAPs
+    Mirror *mirror;
+
+    // this player's next move, if it has been worked out. Only players
+    // have access.
+    Speculation speculation;
+
+    // works out this player's moves instead of its type's strategy, for
+    // players built for one map; NULL otherwise. Only players have access.
+    int (*nextMove)(struct Path *path, int playerId);
+
+    // stages lines sent to every player. Only dealer has access.
+    Broadcast *broadcast;
+
+    // spectators watching the game, or NULL. Only dealer has access.
+    Spectators *spectators;
+
+    // where the board and scores are written; the dealer's stdout or a
+    // player's stderr
+    FILE *log;
+
+    // the compact transcript written instead of the board, or NULL.
+    // Only dealer has access.
+    Transcript *transcript;
+
+    // this game's statistics, or NULL. Only dealer has access.
+    GameStats *stats;
+
+    // the program each player runs, and what each player process has
+    // cost. Only dealer has access.
+    char **programs;
+    SeatUsage *usage;
 } Path;
 
 int check_map_file(char *line, ProcessType processType);
+bool map_file_valid(char *line);
+int read_site_count(const char *line, const char **sites);
+bool wide_sites_valid(const char *sites, int numberOfStops);
+const char *next_site(const char *site, bool fixedWidth, char type[3],
+        int *capacity);
+bool path_contents_valid(char *contents, char *line);
 int check_player_args(int argc, char **argv);
+char program_player_type(const char *program);
 int next_player_to_move(Path *path);
 void sig_handler(int signal);
 int find_next_barrier(Path *path, int currentSiteID);
@@ -116,6 +245,9 @@ int check_if_most_cards(Path *path, Player *player);
 int check_empty_cards(Path *path);
 int player_b_next_move(Path *path, int playerId);
 int check_input(char *line, Path *path, int playerId, char playerType);
+void work_out_move(Path *path, int playerId, char playerType);
+void speculate_move(Path *path, int playerId, char playerType);
+void forget_speculation(Path *path, int moverId, int siteId, int card);
 int sum_cards(Player *player);
 int player_a_next_move(Path *path, int playerId);
 int check_if_last_player(Path *path, Player *player);
@@ -123,16 +255,29 @@ void game_over(Path *path, FILE *location);
 int find_earliest(Path *path, int currentSiteID);
 void start_player(int numPlayers, int id, Path *path, char playerType);
 void print_player_details(Path *path, int playerId, FILE *location);
-int do_ri(Deck *deck, Player *player);
+int do_ri(Path *path, Player *player);
+void give_card(Path *path, Player *player, int suit);
+void recount_cards(Path *path);
+void apply_hap(Path *path, int playerId, int siteId, int points, int money,
+        int card);
 int do_action(Path *path, int playerId);
 int get_highest_score(Path *path, int siteNum);
 void print_path(Path *path, FILE *file);
 Path *allocate_path(char *line, int numPlayers);
+Path *allocate_compiled_path(const CompiledSite *compiledSites, int size,
+        int numPlayers);
+void free_path(Path *path);
+void init_occupants(Site *site);
 int check_game_over(Path *path);
 int calculate_total_score(Player *player);
+int final_score(Player *player);
 Player *init_player(Path *path, int id);
 void move_player(Path *path, int playerId, int steps, ProcessType processType);
 int available(Site site);
+SiteKind site_kind(char *type);
+int find_site(Path *path, unsigned int kinds, bool openOnly, int from, int to);
+void update_open_site(Path *path, int siteID);
+int find_run(Path *path, int siteID);
 void arrange_order_of_players(Path *path);
 int next_player_to_move(Path *path);
 #endif
\ No newline at end of file
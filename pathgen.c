@@ -0,0 +1,163 @@
+#include "pathgen.h"
+
+/** Writes a check that returns the steps to each site of the given kinds
+ *  in [from, to) if it has room, in order, so the first with room is
+ *  taken.
+ *
+ * @param out Where the code is written
+ * @param path The map
+ * @param kinds The KIND_BIT()s of the sites to check
+ * @param from The first site to check
+ * @param to One past the last site to check
+ * @param site The site the player moves from
+ * @param indent How many spaces each line is indented by
+ */
+static void write_first_open(FILE *out, Path *path, unsigned int kinds,
+        int from, int to, int site, int indent) {
+    for (int siteID = from; siteID < to; ++siteID) {
+        if ((kinds & KIND_BIT(path->sites[siteID].kind)) == 0) {
+            continue;
+        }
+        int limit = path->sites[siteID].playerLimit;
+        if (limit == 0) {
+            fprintf(out, "%*sif (SITE_OPEN(path, %d, path->playersInGame)) "
+                    "{\n", indent, "", siteID);
+        } else {
+            fprintf(out, "%*sif (SITE_OPEN(path, %d, %d)) {\n", indent, "",
+                    siteID, limit);
+        }
+        fprintf(out, "%*sreturn %d;\n%*s}\n", indent + 4, "",
+                siteID - site, indent, "");
+    }
+}
+
+/** Writes Player A's move from a site, as player_a_next_move makes it.
+ *
+ * @param out Where the code is written
+ * @param path The map
+ * @param site The site the player moves from
+ * @param barrier The site's next barrier
+ */
+static void write_player_a_case(FILE *out, Path *path, int site,
+        int barrier) {
+    if (find_site(path, KIND_BIT(SITE_DO), false, site + 1, barrier) != -1) {
+        fprintf(out, "            if (player->money > 0) {\n");
+        write_first_open(out, path, KIND_BIT(SITE_DO), site + 1, barrier,
+                site, 16);
+        fprintf(out, "            }\n");
+    }
+    write_first_open(out, path, KIND_BIT(SITE_MO), site + 1, site + 2, site,
+            12);
+    write_first_open(out, path, KIND_BIT(SITE_V1) | KIND_BIT(SITE_V2) |
+            KIND_BIT(SITE_BARRIER), site + 1, barrier + 1, site, 12);
+    fprintf(out, "            return -1;\n");
+}
+
+/** Writes Player B's move from a site, as player_b_next_move makes it.
+ *
+ * @param out Where the code is written
+ * @param path The map
+ * @param site The site the player moves from
+ * @param barrier The site's next barrier
+ */
+static void write_player_b_case(FILE *out, Path *path, int site,
+        int barrier) {
+    int limit = path->sites[site + 1].playerLimit;
+    if (limit == 0) {
+        fprintf(out, "            if (SITE_OPEN(path, %d, "
+                "path->playersInGame) &&\n", site + 1);
+    } else {
+        fprintf(out, "            if (SITE_OPEN(path, %d, %d) &&\n",
+                site + 1, limit);
+    }
+    fprintf(out, "                    check_if_last_player(path, player) "
+            "== 0) {\n                return 1;\n            }\n");
+
+    if (find_site(path, KIND_BIT(SITE_MO), false, site + 1, barrier) != -1) {
+        fprintf(out, "            if (player->money %% 2 == 1) {\n");
+        write_first_open(out, path, KIND_BIT(SITE_MO), site + 1, barrier,
+                site, 16);
+        fprintf(out, "            }\n");
+    }
+    if (find_site(path, KIND_BIT(SITE_RI), false, site + 1, barrier) != -1) {
+        fprintf(out, "            if (!check_if_most_cards(path, player) ||"
+                "\n                    !check_empty_cards(path)) {\n");
+        write_first_open(out, path, KIND_BIT(SITE_RI), site + 1, barrier,
+                site, 16);
+        fprintf(out, "            }\n");
+    }
+    write_first_open(out, path, KIND_BIT(SITE_V2), site + 1, barrier, site,
+            12);
+    write_first_open(out, path, ALL_SITE_KINDS, site + 1, barrier + 1, site,
+            12);
+    fprintf(out, "            return find_earliest(path, %d) - %d;\n", site,
+            site);
+}
+
+/** Writes the map's path line as a C string.
+ *
+ * @param out Where the code is written
+ * @param givenPath The path line
+ */
+static void write_path_string(FILE *out, const char *givenPath) {
+    fprintf(out, "const char MAP_PATH[] =\n        \"");
+    for (int i = 0; givenPath[i] != '\0'; ++i) {
+        if (givenPath[i] == '"' || givenPath[i] == '\\') {
+            fputc('\\', out);
+        }
+        fputc(givenPath[i], out);
+        // keep lines short on long maps
+        if (i % 64 == 63 && givenPath[i + 1] != '\0') {
+            fprintf(out, "\"\n        \"");
+        }
+    }
+    fprintf(out, "\";\n");
+}
+
+/** Writes C code for a player specialised to one map. Each site's move is
+ *  a switch case that checks the sites the strategy would consider, in
+ *  order, with their kinds, capacities and barriers fixed. Built with
+ *  2310mapplayer.c, it moves exactly as Player A or B would.
+ *
+ * @param out Where the code is written
+ * @param path The map, allocated for no players so that sites which hold
+ * any number of players have a limit of 0
+ * @param givenPath The path file's first line
+ * @param fileName The path file, for the header comment
+ * @param playerType 'A' or 'B'
+ */
+void write_map_player(FILE *out, Path *path, const char *givenPath,
+        const char *fileName, char playerType) {
+    fprintf(out, "// Generated by 2310pathgen from %s for Player %c. "
+            "Do not edit.\n", fileName, playerType);
+    fprintf(out, "#include \"2310mapplayer.h\"\n\n");
+    write_path_string(out, givenPath);
+    fprintf(out, "const char MAP_PLAYER_TYPE = '%c';\n\n", playerType);
+
+    fprintf(out, "/** Returns how many steps Player %c takes on this map.\n"
+            " *\n"
+            " * @param path The game path, which must be this map\n"
+            " * @param playerId The player ID\n"
+            " * @return The number of steps\n"
+            " */\n", playerType);
+    fprintf(out, "int map_next_move(Path *path, int playerId) {\n");
+    fprintf(out, "    Player *player = path->players[playerId];\n");
+    fprintf(out, "    switch (player->siteNumber) {\n");
+    // the last site is the final barrier, which no one moves from
+    for (int site = 0; site < path->size - 1; ++site) {
+        int barrier = find_next_barrier(path, site);
+        if (barrier - site > MAX_GENERATED_REACH) {
+            continue;
+        }
+        fprintf(out, "        case %d:\n", site);
+        if (playerType == 'A') {
+            write_player_a_case(out, path, site, barrier);
+        } else {
+            write_player_b_case(out, path, site, barrier);
+        }
+    }
+    fprintf(out, "        default:\n");
+    fprintf(out, "            return player_%c_next_move(path, playerId);\n",
+            playerType == 'A' ? 'a' : 'b');
+    fprintf(out, "    }\n}\n");
+}
@@ -0,0 +1,17 @@
+#ifndef PATHGEN_H
+#define PATHGEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "path.h"
+
+// sites more than this far from their next barrier are left to the
+// general strategy, so the code generated stays small on long stretches
+#define MAX_GENERATED_REACH 64
+
+void write_map_player(FILE *out, Path *path, const char *givenPath,
+        const char *fileName, char playerType);
+
+#endif
@@ -0,0 +1,641 @@
+#define _GNU_SOURCE
+#include "2310dealer.h"
+
+/** Finds the cache's entry for a file as it is now.
+ *
+ * @param cache The cache to search
+ * @param source The file's details, from stat()
+ * @return The entry, or NULL if this version of the file has not been read.
+ */
+CachedFile *find_cached(FileCache *cache, const struct stat *source) {
+    for (int i = 0; i < cache->count; ++i) {
+        CachedFile *file = &cache->files[i];
+        if (file->spec == NULL && file->device == source->st_dev &&
+                file->inode == source->st_ino &&
+                file->size == source->st_size &&
+                file->modified.tv_sec == source->st_mtim.tv_sec &&
+                file->modified.tv_nsec == source->st_mtim.tv_nsec) {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/** Finds the cache's entry for a seed:... spec.
+ *
+ * @param cache The cache to search
+ * @param spec The spec
+ * @return The entry, or NULL if the spec has not been seen.
+ */
+CachedFile *find_cached_spec(FileCache *cache, const char *spec) {
+    for (int i = 0; i < cache->count; ++i) {
+        CachedFile *file = &cache->files[i];
+        if (file->spec != NULL && strcmp(file->spec, spec) == 0) {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/** Adds a new, empty entry to the cache.
+ *
+ * @param cache The cache
+ * @param source The file's details, from stat(), or NULL for a spec
+ * @return The new entry
+ */
+CachedFile *add_cached(FileCache *cache, const struct stat *source) {
+    cache->files = realloc(cache->files,
+            sizeof(CachedFile) * (cache->count + 1));
+    CachedFile *file = &cache->files[cache->count];
+    cache->count += 1;
+
+    memset(file, 0, sizeof(CachedFile));
+    if (source != NULL) {
+        file->device = source->st_dev;
+        file->inode = source->st_ino;
+        file->size = source->st_size;
+        file->modified = source->st_mtim;
+    }
+    file->error = NO_ERROR;
+    return file;
+}
+
+/** Returns the cached seed:... spec, generating its deck the first time
+ *  it is seen.
+ *
+ * @param server The server
+ * @param spec The deck argument
+ * @return The cached spec.
+ */
+CachedFile *cached_seeded_deck(Server *server, char *spec) {
+    CachedFile *file = find_cached_spec(&server->decks, spec);
+    if (file == NULL) {
+        file = add_cached(&server->decks, NULL);
+        file->spec = strdup(spec);
+        Deck *deck = seeded_deck(spec);
+        if (deck == NULL) {
+            file->error = INVALID_DECK_FILE;
+        } else {
+            file->numCards = deck->count;
+            file->seed = strdup(deck->seed);
+            file->cards = take_cards(deck);
+        }
+    }
+    return file;
+}
+
+/** Returns the cached deck file, validating and laying it out the first
+ *  time this version of it is seen.
+ *
+ * @param server The server
+ * @param fileName The deck file, or a seed:... spec
+ * @return The cached deck, or NULL if the file could not be found.
+ */
+CachedFile *cached_deck(Server *server, char *fileName) {
+    if (is_seed_spec(fileName)) {
+        return cached_seeded_deck(server, fileName);
+    }
+    struct stat source;
+    if (stat(fileName, &source) == -1) {
+        return NULL;
+    }
+    CachedFile *file = find_cached(&server->decks, &source);
+    if (file == NULL) {
+        file = add_cached(&server->decks, &source);
+        file->compiled = compile_source(fileName, COMPILED_DECK, &source);
+        if (file->compiled == NULL) {
+            file->error = INVALID_DECK_FILE;
+        }
+    }
+    return file;
+}
+
+/** Returns the cached path file, validating and laying it out the first
+ *  time this version of it is seen.
+ *
+ * @param server The server
+ * @param fileName The path file
+ * @return The cached path, or NULL if the file could not be found.
+ */
+CachedFile *cached_path(Server *server, char *fileName) {
+    struct stat source;
+    if (stat(fileName, &source) == -1) {
+        return NULL;
+    }
+    CachedFile *file = find_cached(&server->paths, &source);
+    if (file == NULL) {
+        file = add_cached(&server->paths, &source);
+        file->compiled = compile_source(fileName, COMPILED_PATH, &source);
+        if (file->compiled == NULL) {
+            file->error = INVALID_PATH_FILE;
+        }
+    }
+    return file;
+}
+
+/** Makes a game its own copy of a valid cached deck, as drawing cards
+ *  changes the deck.
+ *
+ * @param file The cached deck
+ * @return The deck
+ */
+Deck *copy_cached_deck(CachedFile *file) {
+    if (file->spec == NULL) {
+        return deck_from_compiled(file->compiled);
+    }
+    Deck *deck = deck_from_cards(file->cards, file->numCards);
+    deck->seed = strdup(file->seed);
+    return deck;
+}
+
+// set when the server has been asked to stop
+static volatile sig_atomic_t stopServing = 0;
+
+/** Asks the server to stop once it is not handling a request.
+ *
+ * @param signal The signal received
+ */
+static void stop_serving(int signal) {
+    stopServing = 1;
+}
+
+/** Adds bytes to the client's output, unless the client has gone.
+ *
+ * @param served The game
+ * @param bytes The bytes to add
+ * @param length The number of bytes
+ */
+void add_output(ServedGame *served, const char *bytes, size_t length) {
+    if (served->client == -1) {
+        return;
+    }
+    served->output = realloc(served->output, served->outputLength + length);
+    memcpy(&served->output[served->outputLength], bytes, length);
+    served->outputLength += length;
+}
+
+/** Writes to a game's log: adds what the game wrote to the client's
+ *  output. Used as a fopencookie() write function.
+ *
+ * @param cookie The game
+ * @param bytes What was written
+ * @param length How much was written
+ * @return length, as nothing is ever refused
+ */
+static ssize_t write_game_log(void *cookie, const char *bytes,
+        size_t length) {
+    add_output(cookie, bytes, length);
+    count_bytes(CHANNEL_LOG, length);
+    return length;
+}
+
+/** Closes the client's socket and drops whatever it was still to be sent.
+ *
+ * @param served The game
+ */
+void drop_client(ServedGame *served) {
+    close(served->client);
+    served->client = -1;
+    free(served->output);
+    served->output = NULL;
+    served->outputLength = 0;
+}
+
+/** Sends the client as much of its output as it will take without
+ *  blocking, dropping the client if it has gone.
+ *
+ * @param served The game
+ */
+void flush_client(ServedGame *served) {
+    while (served->client != -1 && served->outputLength > 0) {
+        ssize_t sent = send(served->client, served->output,
+                served->outputLength, MSG_NOSIGNAL);
+        if (sent > 0) {
+            served->outputLength -= sent;
+            memmove(served->output, &served->output[sent],
+                    served->outputLength);
+        } else if (sent == -1 && errno == EINTR) {
+            continue;
+        } else if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            drop_client(served);
+        }
+    }
+}
+
+/** Finishes the reply with the dealer's error message, if there is one,
+ *  and an "EXIT code" line.
+ *
+ * @param served The game
+ * @param error The error the dealer would have exited with, or NO_ERROR
+ */
+void reply_exit(ServedGame *served, DealerErrorCode error) {
+    count_error(error);
+    char line[64];
+    int length = snprintf(line, sizeof(line), "%s%sEXIT %d\n",
+            dealer_error_message(error), error == NO_ERROR ? "" : "\n",
+            error == NO_ERROR ? NORMAL_END : error);
+    add_output(served, line, length);
+    served->replied = true;
+}
+
+/** Starts the requested game: its own path and deck made from the cached
+ *  files, and its players forked. A game whose players could not all be
+ *  started is stopped straight away.
+ *
+ * @param server The server
+ * @param served The game
+ * @param deck The cached deck
+ * @param path The cached path
+ * @param numPlayers The number of players
+ */
+void start_served_game(Server *server, ServedGame *served, CachedFile *deck,
+        CachedFile *path, int numPlayers) {
+    char *givenPath;
+    Path *game = path_from_compiled(path->compiled, numPlayers, &givenPath);
+    game->deck = copy_cached_deck(deck);
+    cookie_io_functions_t logWriter = {NULL, write_game_log, NULL, NULL};
+    served->log = fopencookie(served, "w", logWriter);
+    game->log = served->log;
+
+    bool started = setup_players(game, numPlayers) &&
+            make_forks(numPlayers, game, served->argv);
+    game->stats = start_game_stats(server->stats, &served->argv[3],
+            numPlayers);
+    game->transcript = create_transcript(givenPath, game->deck,
+            numPlayers);
+
+    served->game = create_game(game, givenPath);
+    if (!started) {
+        stop_game(served->game, ERROR_STARTING_PLAYER);
+    }
+    advance_game(served->game);
+}
+
+/** Sends the result of a finished game and frees it. Players which have
+ *  not been reaped are kept to be reaped later.
+ *
+ * @param server The server
+ * @param served The game
+ */
+void finish_served_game(Server *server, ServedGame *served) {
+    Game *game = served->game;
+    Path *path = game->path;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        SeatUsage *seat = &path->usage[playerId];
+        if (!seat->reaped && seat->pid > 0) {
+            server->strays = realloc(server->strays,
+                    sizeof(pid_t) * (server->numStrays + 1));
+            server->strays[server->numStrays] = seat->pid;
+            server->numStrays += 1;
+        }
+    }
+
+    fclose(served->log);
+    served->log = NULL;
+    DealerErrorCode error = game->error;
+    free_game(game);
+    served->game = NULL;
+    reply_exit(served, error);
+    flush_client(served);
+}
+
+/** Reaps players which outlived their game's wait for them. **/
+void reap_strays(Server *server) {
+    for (int i = server->numStrays - 1; i >= 0; --i) {
+        pid_t reaped = waitpid(server->strays[i], NULL, WNOHANG);
+        if (reaped == server->strays[i] || (reaped == -1 &&
+                errno == ECHILD)) {
+            server->numStrays -= 1;
+            server->strays[i] = server->strays[server->numStrays];
+        }
+    }
+}
+
+/** Returns whether the game is over and the client has been sent all of
+ *  its reply, or has gone.
+ *
+ * @param served The game
+ * @return true if the game can be freed
+ */
+bool served_done(ServedGame *served) {
+    return served->replied &&
+            (served->client == -1 || served->outputLength == 0);
+}
+
+/** Closes the client's socket and frees what is left of a game.
+ *
+ * @param served The game
+ */
+void free_served(ServedGame *served) {
+    if (served->client != -1) {
+        close(served->client);
+    }
+    free(served->output);
+    free(served->request);
+    free(served);
+}
+
+/** Starts the requested game, its output going to the client and
+ *  finishing with an "EXIT code" line. A request which can't be run is
+ *  answered straight away.
+ *
+ * @param server The server
+ * @param client The client's socket
+ * @param request The request line, or "\a" if it was empty, which the
+ * game takes
+ */
+void handle_request(Server *server, int client, char *request) {
+    ServedGame *served = calloc(1, sizeof(ServedGame));
+    served->client = client;
+    served->request = request;
+
+    // the request is laid out the same as the dealer's arguments
+    char **argv = served->argv;
+    int argc = 1;
+    argv[0] = "2310dealer";
+    char *firstArg = strcmp(request, "\a") == 0 ? NULL :
+            strtok(request, " ");
+    for (char *arg = firstArg; arg != NULL; arg = strtok(NULL, " ")) {
+        if (argc <= MAX_REQUEST_ARGS) {
+            argv[argc] = arg;
+        }
+        argc += 1;
+    }
+
+    DealerErrorCode error = NO_ERROR;
+    CachedFile *deck = NULL;
+    CachedFile *path = NULL;
+    if (argc > MAX_REQUEST_ARGS || argc < 4) {
+        error = INVALID_NUM_ARGS;
+    } else if ((deck = cached_deck(server, argv[1])) == NULL ||
+            deck->error != NO_ERROR) {
+        error = INVALID_DECK_FILE;
+    } else if ((path = cached_path(server, argv[2])) == NULL ||
+            path->error != NO_ERROR) {
+        error = INVALID_PATH_FILE;
+    }
+    argv[argc <= MAX_REQUEST_ARGS ? argc : MAX_REQUEST_ARGS + 1] = NULL;
+
+    if (error != NO_ERROR) {
+        reply_exit(served, error);
+        flush_client(served);
+    } else {
+        start_served_game(server, served, deck, path, argc - 3);
+    }
+    if (served_done(served)) {
+        free_served(served);
+        return;
+    }
+    server->games = realloc(server->games,
+            sizeof(ServedGame *) * (server->numGames + 1));
+    server->games[server->numGames] = served;
+    server->numGames += 1;
+}
+
+/** Accepts a client and waits for its request with the others.
+ *
+ * @param server The server
+ */
+void accept_request(Server *server) {
+    int client = accept(server->listener, NULL, NULL);
+    if (client == -1) {
+        return;
+    }
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+    fcntl(client, F_SETFD, FD_CLOEXEC);
+
+    server->requests = realloc(server->requests,
+            sizeof(PendingRequest) * (server->numRequests + 1));
+    PendingRequest *pending = &server->requests[server->numRequests];
+    server->numRequests += 1;
+    pending->client = client;
+    pending->line = NULL;
+    pending->length = 0;
+    clock_gettime(CLOCK_MONOTONIC, &pending->accepted);
+}
+
+/** Reads whatever a client has sent of its request.
+ *
+ * @param pending The client
+ * @return true once the whole line is in, the client has stopped sending
+ * or the request is as long as is allowed.
+ */
+bool read_request(PendingRequest *pending) {
+    char buffer[4096];
+    ssize_t got = read(pending->client, buffer, sizeof(buffer));
+    if (got == -1) {
+        return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+    }
+    if (got == 0) {
+        return true;
+    }
+    pending->line = realloc(pending->line, pending->length + got + 1);
+    memcpy(&pending->line[pending->length], buffer, got);
+    pending->length += got;
+    pending->line[pending->length] = '\0';
+    return memchr(buffer, '\n', got) != NULL ||
+            pending->length >= MAX_REQUEST_LENGTH;
+}
+
+/** Runs the first line of a client's request and stops waiting on the
+ *  client. A request which never got to the end of its line, as the
+ *  client stopped sending, took too long or sent too much, is a usage
+ *  error.
+ *
+ * @param server The server
+ * @param index The client's place in the server's requests
+ */
+void finish_request(Server *server, int index) {
+    PendingRequest pending = server->requests[index];
+    server->numRequests -= 1;
+    server->requests[index] = server->requests[server->numRequests];
+
+    char *newline = pending.line == NULL ? NULL :
+            strchr(pending.line, '\n');
+    size_t length = newline == NULL ? 0 : (size_t) (newline - pending.line);
+    char *request = length == 0 ? strdup("\a") :
+            strndup(pending.line, length);
+    free(pending.line);
+    handle_request(server, pending.client, request);
+}
+
+/** Fills in the fds a served game is waiting on: its client, which is
+ *  watched for going away and for room for its output, then the game's.
+ *
+ * @param served The game
+ * @param fds Where to put them
+ * @return How many fds were filled in
+ */
+int served_poll_fds(ServedGame *served, struct pollfd *fds) {
+    fds[0].fd = served->client;
+    fds[0].events = served->outputLength > 0 ? POLLOUT : 0;
+    served->numFds = 0;
+    if (served->game != NULL) {
+        served->numFds = game_poll_fds(served->game, &fds[1]);
+    }
+    return served->numFds + 1;
+}
+
+/** Runs a served game as far as it can go once poll() has returned,
+ *  sends its client what it can and finishes the game if it is over. A
+ *  game whose client has gone is ended early.
+ *
+ * @param server The server
+ * @param served The game
+ * @param fds The server's poll() set
+ */
+void service_served_game(Server *server, ServedGame *served,
+        struct pollfd *fds) {
+    if (served->game != NULL) {
+        service_game(served->game, &fds[served->firstFd], served->numFds);
+    }
+    if ((fds[served->clientFd].revents & (POLLHUP | POLLERR)) != 0) {
+        drop_client(served);
+    }
+    flush_client(served);
+
+    Game *game = served->game;
+    if (game == NULL) {
+        return;
+    }
+    if (served->client == -1 && (game->phase == AWAIT_CARAT ||
+            game->phase == AWAIT_MOVE)) {
+        end_game_early(game);
+        advance_game(game);
+    }
+    if (game->phase == GAME_FINISHED) {
+        finish_served_game(server, served);
+    }
+}
+
+/** Waits for something to do: a client connecting or sending its
+ *  request, a game's player sending something or having room for more,
+ *  a client having room for its output, or a client which has taken too
+ *  long.
+ *
+ * @param server The server
+ */
+void serve_once(Server *server) {
+    int count = server->numRequests;
+    int maxFds = count + 1;
+    for (int i = 0; i < server->numGames; ++i) {
+        ServedGame *served = server->games[i];
+        maxFds += 1 + (served->game != NULL ?
+                GAME_MAX_FDS(served->game) : 0);
+    }
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * maxFds);
+
+    fds[0].fd = server->listener;
+    fds[0].events = POLLIN;
+    for (int i = 0; i < count; ++i) {
+        fds[i + 1].fd = server->requests[i].client;
+        fds[i + 1].events = POLLIN;
+    }
+    int used = count + 1;
+    int timeout = count > 0 || server->numStrays > 0 ? 1000 : -1;
+    for (int i = 0; i < server->numGames; ++i) {
+        ServedGame *served = server->games[i];
+        served->clientFd = used;
+        served->firstFd = used + 1;
+        used += served_poll_fds(served, &fds[used]);
+        if (served->game != NULL) {
+            timeout = sooner_timeout(timeout, game_timeout(served->game));
+        }
+    }
+    if (poll(fds, used, timeout) == -1) {
+        free(fds);
+        return;
+    }
+
+    // backwards, as freeing a game moves the last one into its place
+    for (int i = server->numGames - 1; i >= 0; --i) {
+        ServedGame *served = server->games[i];
+        service_served_game(server, served, fds);
+        if (served_done(served)) {
+            free_served(served);
+            server->numGames -= 1;
+            server->games[i] = server->games[server->numGames];
+        }
+    }
+    reap_strays(server);
+
+    // backwards, as finishing a request moves the last one into its place
+    for (int i = count - 1; i >= 0; --i) {
+        PendingRequest *pending = &server->requests[i];
+        bool ready = fds[i + 1].revents != 0 && read_request(pending);
+        if (ready || elapsed_nanos(&pending->accepted) >
+                (int64_t) REQUEST_TIMEOUT * 1000000000) {
+            finish_request(server, i);
+        }
+    }
+    if (fds[0].revents != 0) {
+        accept_request(server);
+    }
+    free(fds);
+}
+
+/** Runs the game server: accepts one game request per connection on the
+ *  socket and runs every game in this process, each resumed only when one
+ *  of its players or its client is ready, with the paths and decks it is
+ *  given read and laid out once for each version of each file.
+ *
+ *  A request is one line, "deck path p1 {p2}", and the reply is the
+ *  dealer's output followed by "EXIT code". If METRICS_ENV is set, the
+ *  live metrics cover every game served. Once stopped, it takes no more
+ *  requests but plays out the games it has started.
+ *
+ * @param socketPath Where to listen
+ * @return 1 on failure to listen, 0 when stopped by SIGINT or SIGTERM.
+ */
+int serve(char *socketPath) {
+    Server server;
+    server.listener = listen_unix(socketPath, false);
+    if (server.listener == -1) {
+        fprintf(stderr, "Error listening on %s\n", socketPath);
+        return 1;
+    }
+    server.decks.files = NULL;
+    server.decks.count = 0;
+    server.paths.files = NULL;
+    server.paths.count = 0;
+    server.requests = NULL;
+    server.numRequests = 0;
+    server.games = NULL;
+    server.numGames = 0;
+    server.strays = NULL;
+    server.numStrays = 0;
+    server.stats = create_stats();
+    start_trace("2310dealer");
+
+    // no SA_RESTART, so a stop interrupts poll()
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = stop_serving;
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+
+    while (!stopServing) {
+        serve_once(&server);
+    }
+
+    close(server.listener);
+    // left alone if another server has taken the path since
+    remove_stale_socket(socketPath);
+    // poll() skips negative fds, so nothing more is accepted
+    server.listener = -1;
+    for (int i = 0; i < server.numRequests; ++i) {
+        close(server.requests[i].client);
+        free(server.requests[i].line);
+    }
+    server.numRequests = 0;
+    while (server.numGames > 0) {
+        serve_once(&server);
+    }
+
+    if (server.stats != NULL) {
+        write_stats_report(server.stats, getenv(STATS_ENV));
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include "util.h"
+#include "path.h"
+#include "deck.h"
+#include "compiled.h"
+
+// 2310dealer --serve socket runs games for requests made on the socket
+#define SERVE_FLAG "--serve"
+
+// the most arguments in a game request, as for 2310dealer
+#define MAX_REQUEST_ARGS (3 + MAX_PLAYERS)
+
+// seconds a client has to send its request
+#define REQUEST_TIMEOUT 5
+
+// the longest request read; anything after this is not waited for
+#define MAX_REQUEST_LENGTH 65536
+
+/** A deck or path file which has been read, validated and laid out, or a
+ *  seed:... deck spec which has been generated.
+ */
+typedef struct CachedFile {
+    // the file and the version of it which was read, going by its size
+    // and modification time; a file changed since gets a new entry
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec modified;
+
+    // the seed:... spec of a generated deck, or NULL for files
+    char *spec;
+
+    // the error the dealer would exit with for this file, or NO_ERROR
+    DealerErrorCode error;
+
+    // the file laid out as compile_source() does, which each game's own
+    // path or deck is made from; NULL for specs and invalid files
+    CompiledHeader *compiled;
+
+    // a generated deck's cards, drawn once for every game using the spec,
+    // and the spec with every parameter filled in, as the deck records it
+    char *cards;
+    int numCards;
+    char *seed;
+} CachedFile;
+
+/** Files the server has seen. **/
+typedef struct FileCache {
+    CachedFile *files;
+    int count;
+} FileCache;
+
+/** A client whose request line has not all arrived yet. **/
+typedef struct PendingRequest {
+    // the client's socket, non-blocking until the request is read
+    int client;
+
+    // what has been read so far
+    char *line;
+    size_t length;
+
+    // when the client connected, so a silent client can be given up on
+    struct timespec accepted;
+} PendingRequest;
+
+struct Game;
+
+/** A game the server is running for a client, or the reply to a request
+ *  which could not be run.
+ */
+typedef struct ServedGame {
+    // the client's socket, non-blocking, or -1 once the client has gone
+    int client;
+
+    // the request, laid out as the dealer's arguments; the game's program
+    // names point into it
+    char *request;
+    char *argv[MAX_REQUEST_ARGS + 2];
+
+    // the game, or NULL once it has finished or if it was never started
+    struct Game *game;
+
+    // the game's log, which adds what is written to it to the output
+    FILE *log;
+
+    // output the client has not taken yet
+    char *output;
+    size_t outputLength;
+
+    // set once the "EXIT code" line has been added to the output
+    bool replied;
+
+    // where the game's fds are in the server's poll() set, and the
+    // client's
+    int firstFd;
+    int numFds;
+    int clientFd;
+} ServedGame;
+
+/** The game server. If STATS_ENV is set, the statistics report is written
+ *  when the server is stopped with SIGINT or SIGTERM.
+ */
+typedef struct Server {
+    int listener;
+    FileCache decks;
+    FileCache paths;
+
+    // clients still sending their request, read as poll() finds input so
+    // a slow client holds up no one else
+    PendingRequest *requests;
+    int numRequests;
+
+    // the games being run, each only resumed when poll() finds one of its
+    // players ready, so no game holds up another
+    ServedGame **games;
+    int numGames;
+
+    // players which outlived their game's wait for them, reaped whenever
+    // they do exit
+    pid_t *strays;
+    int numStrays;
+
+    // statistics over every game served, or NULL
+    Stats *stats;
+} Server;
+
+int serve(char *socketPath);
+
+#endif
@@ -0,0 +1,457 @@
+#include "solve.h"
+
+/** Makes a solver for a game. Nothing is searched until solve_game.
+ *
+ * @param givenPath The first line of a valid path file
+ * @param numPlayers The number of players
+ * @param playsB Whether each seat plays as Player B rather than A
+ * @param cards The deck in draw order
+ * @param numCards The number of cards
+ * @param tableBytes Roughly how much the transposition table may use
+ * @return The solver
+ */
+Solver *create_solver(char *givenPath, int numPlayers, bool *playsB,
+        const char *cards, int numCards, size_t tableBytes) {
+    Solver *solver = malloc(sizeof(Solver));
+    Path *path = allocate_path(givenPath, numPlayers);
+    solver->givenPath = givenPath;
+    solver->numPlayers = numPlayers;
+    solver->size = path->size;
+    solver->playsB = playsB;
+    solver->cards = cards;
+    solver->numCards = numCards;
+
+    // landing on a Mo or Ri adds at most 2 to score_bound, a V1 or V2 1
+    solver->gainAfter = malloc(sizeof(int) * path->size);
+    int gain = 0;
+    for (int site = path->size - 1; site >= 0; --site) {
+        solver->gainAfter[site] = gain;
+        SiteKind kind = path->sites[site].kind;
+        gain += kind == SITE_MO || kind == SITE_RI ? 2 :
+                kind == SITE_V1 || kind == SITE_V2 ? 1 : 0;
+    }
+    free_path(path);
+
+    // the keys only need to differ, so a fixed seed is fine
+    uint64_t state = 2310;
+    solver->siteKeys = malloc(sizeof(uint64_t) * numPlayers * solver->size);
+    for (int i = 0; i < numPlayers * solver->size; ++i) {
+        solver->siteKeys[i] = next_random(&state);
+    }
+    // one extra for the seat
+    solver->playerKeys = malloc(sizeof(uint64_t) * (numPlayers + 1));
+    for (int i = 0; i <= numPlayers; ++i) {
+        solver->playerKeys[i] = next_random(&state);
+    }
+
+    size_t entries = 1;
+    while (entries * 2 * sizeof(TableEntry) <= tableBytes) {
+        entries *= 2;
+    }
+    solver->table = calloc(entries, sizeof(TableEntry));
+    solver->tableMask = entries - 1;
+
+    solver->tasks = NULL;
+    solver->numTasks = 0;
+    solver->nextTask = 0;
+    solver->nodes = 0;
+    return solver;
+}
+
+/** Sets the search's game back to the start, taking back every move made
+ *  on it, or setting it up if it has not been.
+ *
+ * @param search The search
+ * @param solver The solver
+ */
+static void start_search(Search *search, Solver *solver) {
+    search->solver = solver;
+    if (search->path != NULL) {
+        journal_rewind(search->journal, search->path, 0);
+    } else {
+        Path *path = allocate_path(solver->givenPath, solver->numPlayers);
+        path->players = malloc(sizeof(Player *) * solver->numPlayers);
+        for (int i = 0; i < solver->numPlayers; ++i) {
+            path->players[i] = init_player(path, i);
+        }
+        arrange_order_of_players(path);
+        path->deck = deck_from_cards(solver->cards, solver->numCards);
+        search->path = path;
+        search->journal = create_journal();
+    }
+
+    search->siteHash = 0;
+    for (int i = 0; i < solver->numPlayers; ++i) {
+        search->siteHash ^= solver->siteKeys[i * solver->size];
+    }
+}
+
+/** Frees the search's game, if it was set up. **/
+static void end_search(Search *search) {
+    if (search->path != NULL) {
+        free_deck(search->path->deck);
+        free_path(search->path);
+        free_journal(search->journal);
+    }
+}
+
+/** Returns how many steps the player's own strategy would take. **/
+static int strategy_steps(Search *search, int playerId) {
+    if (search->solver->playsB[playerId]) {
+        return player_b_next_move(search->path, playerId);
+    }
+    return player_a_next_move(search->path, playerId);
+}
+
+/** Makes a move as the dealer would, keeping the site hash up to date.
+ *
+ * @param search The search
+ * @param playerId The player moving
+ * @param steps How far they move
+ */
+static void play(Search *search, int playerId, int steps) {
+    Solver *solver = search->solver;
+    uint64_t *keys = &solver->siteKeys[playerId * solver->size];
+    int site = search->path->players[playerId]->siteNumber;
+
+    search->siteHash ^= keys[site] ^ keys[site + steps];
+    journal_move(search->journal, search->path, playerId, steps);
+}
+
+/** Takes back the last move made by play.
+ *
+ * @param search The search
+ */
+static void undo_play(Search *search) {
+    Solver *solver = search->solver;
+    JournalEntry *entry =
+            &search->journal->entries[search->journal->depth - 1];
+    uint64_t *keys = &solver->siteKeys[entry->playerId * solver->size];
+    int site = search->path->players[entry->playerId]->siteNumber;
+
+    search->siteHash ^= keys[site] ^ keys[site - entry->steps];
+    journal_undo(search->journal, search->path);
+}
+
+/** Mixes a value into a hash. **/
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    uint64_t state = hash ^ value;
+    return next_random(&state);
+}
+
+/** Returns the transposition table key of the search's state for a seat.
+ *  Occupancy is hashed as players move; everything else is hashed here.
+ *
+ * @param search The search
+ * @param seat The seat being solved
+ * @return The key
+ */
+static uint64_t state_key(Search *search, int seat) {
+    Solver *solver = search->solver;
+    uint64_t key = search->siteHash ^ mix(solver->playerKeys[
+            solver->numPlayers], ((uint64_t) seat << 32) |
+            (uint32_t) search->path->deck->drawn);
+    for (int i = 0; i < solver->numPlayers; ++i) {
+        Player *player = search->path->players[i];
+        uint64_t hash = solver->playerKeys[i];
+        hash = mix(hash, ((uint64_t) (uint32_t) player->money << 32) |
+                (uint32_t) player->points);
+        hash = mix(hash, ((uint64_t) (uint32_t) player->countV1 << 32) |
+                (uint32_t) player->countV2);
+        hash = mix(hash, (uint32_t) player->position);
+        for (int suit = A; suit <= E; suit += 2) {
+            uint64_t high = suit + 1 <= E ?
+                    (uint32_t) player->cards[suit + 1] : 0;
+            hash = mix(hash, (high << 32) | (uint32_t) player->cards[suit]);
+        }
+        key ^= hash;
+    }
+    return key;
+}
+
+/** Returns the value kept for the key if it settles the node: an exact
+ *  value, or a bound showing the node cannot beat alpha.
+ *
+ * @param solver The solver
+ * @param key The node's key
+ * @param alpha The score the node has to beat
+ * @return The value, or -1 if the node must be searched
+ */
+static int probe_table(Solver *solver, uint64_t key, int alpha) {
+    TableEntry *entry = &solver->table[key & solver->tableMask];
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    if ((check ^ data) != key) {
+        return -1;
+    }
+    int value = (int) (uint32_t) data;
+    if ((data & TABLE_UPPER_BOUND) != 0 && value > alpha) {
+        return -1;
+    }
+    return value;
+}
+
+/** Keeps the value for the key, replacing whatever was in its slot.
+ *
+ * @param solver The solver
+ * @param key The node's key
+ * @param value The node's value
+ * @param upperBound Whether the value is only an upper bound
+ */
+static void store_table(Solver *solver, uint64_t key, int value,
+        bool upperBound) {
+    TableEntry *entry = &solver->table[key & solver->tableMask];
+    uint64_t data = (uint32_t) value | (upperBound ? TABLE_UPPER_BOUND : 0);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+/** Lists the sites a player may move to: those with room up to and
+ *  including the next barrier. The sites Player A and Player B would pick
+ *  come first, the player's own strategy's first, as one of them is
+ *  usually best and finding a good score early lets more moves be
+ *  skipped.
+ *
+ * @param search The search
+ * @param playerId The player
+ * @param sites Filled with the sites; needs room for every site
+ * @return The number of sites
+ */
+static int legal_moves(Search *search, int playerId, int *sites) {
+    Path *path = search->path;
+    int site = path->players[playerId]->siteNumber;
+    int barrier = find_next_barrier(path, site);
+    int count = 0;
+
+    int picks[2] = {site + player_a_next_move(path, playerId),
+            site + player_b_next_move(path, playerId)};
+    if (search->solver->playsB[playerId]) {
+        picks[0] = picks[1];
+        picks[1] = site + player_a_next_move(path, playerId);
+    }
+    for (int pick = 0; pick < 2; ++pick) {
+        if (picks[pick] > site && picks[pick] <= barrier &&
+                available(path->sites[picks[pick]]) == 0 &&
+                (count == 0 || sites[0] != picks[pick])) {
+            sites[count] = picks[pick];
+            count += 1;
+        }
+    }
+
+    for (int next = find_site(path, ALL_SITE_KINDS, true, site + 1,
+            barrier + 1); next != -1; next = find_site(path,
+            ALL_SITE_KINDS, true, next + 1, barrier + 1)) {
+        bool listed = false;
+        for (int i = 0; i < count && i < 2; ++i) {
+            listed |= sites[i] == next;
+        }
+        if (!listed) {
+            sites[count] = next;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+/** Returns the most the seat could still score. final_score is never more
+ *  than this, as no set of cards scores more than 2 a card, and landing on
+ *  a site adds no more to it than gainAfter allows for.
+ *
+ * @param search The search
+ * @param seat The seat
+ * @return An upper bound on the seat's final score
+ */
+static int score_bound(Search *search, int seat) {
+    Player *player = search->path->players[seat];
+    return player->points + player->countV1 + player->countV2 +
+            player->money / 2 + 2 * player->cardTotal +
+            search->solver->gainAfter[player->siteNumber];
+}
+
+/** Returns the best final score the seat can get from here, with every
+ *  other seat playing its strategy. Only scores above alpha are looked
+ *  for: if the seat cannot beat alpha, alpha is returned.
+ *
+ * @param search The search, left as it was found
+ * @param seat The seat
+ * @param alpha A score the caller already has
+ * @return The best final score if it is above alpha, otherwise alpha
+ */
+static int solve_node(Search *search, int seat, int alpha) {
+    Path *path = search->path;
+    search->nodes += 1;
+    if (check_game_over(path) == 0) {
+        int score = final_score(path->players[seat]);
+        return score > alpha ? score : alpha;
+    }
+
+    int mover = next_player_to_move(path);
+    if (mover != seat) {
+        play(search, mover, strategy_steps(search, mover));
+        int value = solve_node(search, seat, alpha);
+        undo_play(search);
+        return value;
+    }
+
+    uint64_t key = state_key(search, seat);
+    int best = probe_table(search->solver, key, alpha);
+    if (best != -1) {
+        return best > alpha ? best : alpha;
+    }
+
+    int sites[path->size];
+    int numMoves = legal_moves(search, seat, sites);
+    int site = path->players[seat]->siteNumber;
+    best = alpha;
+    for (int i = 0; i < numMoves; ++i) {
+        play(search, seat, sites[i] - site);
+        // moves which cannot beat the best so far are not searched
+        if (score_bound(search, seat) > best) {
+            best = solve_node(search, seat, best);
+        }
+        undo_play(search);
+    }
+
+    store_table(search->solver, key, best, best == alpha);
+    return best;
+}
+
+/** Plays every other seat's moves until it is the seat's turn. **/
+static void advance_to_seat(Search *search, int seat) {
+    while (check_game_over(search->path) != 0 &&
+            next_player_to_move(search->path) != seat) {
+        int mover = next_player_to_move(search->path);
+        play(search, mover, strategy_steps(search, mover));
+    }
+}
+
+/** Searches tasks until there are none left.
+ *
+ * @param arg The solver
+ * @return NULL
+ */
+static void *solve_worker(void *arg) {
+    Solver *solver = arg;
+    Search search = {.path = NULL, .nodes = 0};
+
+    while (true) {
+        int taskNum = __atomic_fetch_add(&solver->nextTask, 1,
+                __ATOMIC_RELAXED);
+        if (taskNum >= solver->numTasks) {
+            break;
+        }
+        SolveTask *task = &solver->tasks[taskNum];
+        start_search(&search, solver);
+        advance_to_seat(&search, task->seat);
+        int site = search.path->players[task->seat]->siteNumber;
+        play(&search, task->seat, task->site - site);
+        // another first move may already have found a score to beat
+        int *seatBest = &solver->seatBest[task->seat];
+        int value = solve_node(&search, task->seat,
+                __atomic_load_n(seatBest, __ATOMIC_RELAXED));
+        int best = __atomic_load_n(seatBest, __ATOMIC_RELAXED);
+        while (value > best && !__atomic_compare_exchange_n(seatBest, &best,
+                value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    __atomic_fetch_add(&solver->nodes, search.nodes, __ATOMIC_RELAXED);
+    end_search(&search);
+    return NULL;
+}
+
+/** Finds every seat's best score, a task for each of each seat's first
+ *  moves, shared out between threads.
+ *
+ * @param solver The solver
+ * @param numThreads The number of threads to search with
+ */
+void solve_game(Solver *solver, int numThreads) {
+    Search search = {.path = NULL};
+    solver->tasks = malloc(sizeof(SolveTask) * solver->numPlayers *
+            solver->size);
+    solver->seatBest = malloc(sizeof(int) * solver->numPlayers);
+    for (int seat = 0; seat < solver->numPlayers; ++seat) {
+        solver->seatBest[seat] = -1;
+        start_search(&search, solver);
+        advance_to_seat(&search, seat);
+        int sites[solver->size];
+        int numMoves = legal_moves(&search, seat, sites);
+        for (int i = 0; i < numMoves; ++i) {
+            solver->tasks[solver->numTasks].seat = seat;
+            solver->tasks[solver->numTasks].site = sites[i];
+            solver->numTasks += 1;
+        }
+    }
+    end_search(&search);
+
+    pthread_t threads[numThreads];
+    for (int i = 1; i < numThreads; ++i) {
+        pthread_create(&threads[i], NULL, solve_worker, solver);
+    }
+    solve_worker(solver);
+    for (int i = 1; i < numThreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/** Returns the best final score the seat can get, once solved. **/
+int best_score(Solver *solver, int seat) {
+    return solver->seatBest[seat];
+}
+
+/** Finds the sites the seat moves to on the way to its best score, once
+ *  solved. Where moves are equally good, the one listed first is taken.
+ *
+ * @param solver The solver
+ * @param seat The seat
+ * @param line Filled with the sites; needs room for every site
+ * @return The number of moves
+ */
+int best_line(Solver *solver, int seat, int *line) {
+    Search search = {.path = NULL, .nodes = 0};
+    int length = 0;
+    start_search(&search, solver);
+
+    while (true) {
+        advance_to_seat(&search, seat);
+        if (check_game_over(search.path) == 0) {
+            break;
+        }
+        int sites[solver->size];
+        int numMoves = legal_moves(&search, seat, sites);
+        int site = search.path->players[seat]->siteNumber;
+        int best = -1;
+        int bestSite = sites[0];
+        for (int i = 0; i < numMoves; ++i) {
+            play(&search, seat, sites[i] - site);
+            int value = solve_node(&search, seat, best);
+            undo_play(&search);
+            if (value > best) {
+                best = value;
+                bestSite = sites[i];
+            }
+        }
+        play(&search, seat, bestSite - site);
+        line[length] = bestSite;
+        length += 1;
+    }
+
+    end_search(&search);
+    return length;
+}
+
+/** Returns the seat's final score with every seat playing its strategy,
+ *  as the dealer would report it.
+ */
+int strategy_score(Solver *solver, int seat) {
+    Search search = {.path = NULL};
+    start_search(&search, solver);
+    while (check_game_over(search.path) != 0) {
+        int mover = next_player_to_move(search.path);
+        play(&search, mover, strategy_steps(&search, mover));
+    }
+    int score = final_score(search.path->players[seat]);
+    end_search(&search);
+    return score;
+}
@@ -0,0 +1,90 @@
+#ifndef SOLVE_H
+#define SOLVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "util.h"
+#include "path.h"
+#include "journal.h"
+
+// set to the number of threads to search with; defaults to one per CPU
+#define SOLVE_THREADS_ENV "SOLVE_THREADS"
+// set to the megabytes the transposition table may use
+#define SOLVE_TABLE_ENV "SOLVE_TABLE_MB"
+#define DEFAULT_TABLE_MB 64
+
+// set in an entry's data when its value is only an upper bound
+#define TABLE_UPPER_BOUND ((uint64_t) 1 << 32)
+
+/** A slot of the transposition table. check is the key XORed with data,
+ *  so a slot torn by two threads writing at once never matches a key.
+ */
+typedef struct TableEntry {
+    uint64_t check;
+    uint64_t data;
+} TableEntry;
+
+/** A seat's first choice of move, searched as one piece of work. **/
+typedef struct SolveTask {
+    int seat;
+    int site;
+} SolveTask;
+
+/** A game to find each seat's best response in, with every other seat
+ *  playing its own strategy. Shared by the search threads.
+ */
+typedef struct Solver {
+    char *givenPath;
+    int numPlayers;
+    int size;
+    bool *playsB;
+    const char *cards;
+    int numCards;
+
+    // the most landing on each site after a site could add to a score
+    int *gainAfter;
+
+    // random keys for each player on each site, and for each player's
+    // other fields and the seat being solved
+    uint64_t *siteKeys;
+    uint64_t *playerKeys;
+
+    // a power of two entries, found by the low bits of the key
+    TableEntry *table;
+    uint64_t tableMask;
+
+    SolveTask *tasks;
+    int numTasks;
+    int nextTask;
+
+    // the best score found for each seat so far
+    int *seatBest;
+
+    uint64_t nodes;
+} Solver;
+
+/** One thread's copy of the game, moved forward and back as it is
+ *  searched.
+ */
+typedef struct Search {
+    Solver *solver;
+    Path *path;
+    Journal *journal;
+
+    // XOR of the keys of every player's site
+    uint64_t siteHash;
+    uint64_t nodes;
+} Search;
+
+Solver *create_solver(char *givenPath, int numPlayers, bool *playsB,
+        const char *cards, int numCards, size_t tableBytes);
+void solve_game(Solver *solver, int numThreads);
+int best_score(Solver *solver, int seat);
+int best_line(Solver *solver, int seat, int *line);
+int strategy_score(Solver *solver, int seat);
+
+#endif
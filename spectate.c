@@ -0,0 +1,230 @@
+#include "spectate.h"
+#include "metrics.h"
+#include "path.h"
+
+/** Makes the fd non-blocking.
+ *
+ * @param fd The fd
+ * @return 0 on success
+ */
+int set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/** Listens for spectators on the socket named by SPECTATE_ENV.
+ *
+ * @param givenPath The contents of the path file
+ * @return The spectators, or NULL if spectating is off or unavailable.
+ */
+Spectators *create_spectators(char *givenPath) {
+    char *socketPath = getenv(SPECTATE_ENV);
+    if (socketPath == NULL) {
+        return NULL;
+    }
+    int listener = listen_unix(socketPath, true);
+    if (listener == -1) {
+        return NULL;
+    }
+
+    Spectators *spectators = malloc(sizeof(Spectators));
+    spectators->listener = listener;
+    spectators->socketPath = strdup(socketPath);
+    spectators->givenPath = givenPath;
+    spectators->turn = 0;
+    spectators->clients = NULL;
+    spectators->count = 0;
+
+    return spectators;
+}
+
+/** Closes the spectator's socket and removes it from the list.
+ *
+ * @param spectators The spectators
+ * @param index The index of the spectator to drop
+ */
+void drop_spectator(Spectators *spectators, int index) {
+    Spectator *spectator = &spectators->clients[index];
+    close(spectator->fd);
+    free(spectator->queue);
+
+    spectators->count -= 1;
+    spectators->clients[index] = spectators->clients[spectators->count];
+}
+
+/** Adds the event to the spectator's queue if it fits.
+ *
+ * @param spectator The spectator
+ * @param event The event line
+ * @param length The length of the event
+ * @return true if the event was queued, false if it was skipped.
+ */
+bool queue_event(Spectator *spectator, const char *event, size_t length) {
+    if (spectator->queued + length > spectator->capacity) {
+        spectator->skipped += 1;
+        return false;
+    }
+    memcpy(&spectator->queue[spectator->queued], event, length);
+    spectator->queued += length;
+    spectator->skipped = 0;
+    return true;
+}
+
+/** Formats a player's current state as an AT event.
+ *
+ * @param player The player
+ * @param event Where to write the event
+ * @param size The size of event
+ * @return The length of the event
+ */
+int format_player(Player *player, char *event, size_t size) {
+    int *cards = player->cards;
+    return snprintf(event, size, "AT %d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+            player->id, player->siteNumber, player->points, player->money,
+            player->countV1, player->countV2, cards[A], cards[B], cards[C],
+            cards[D], cards[E]);
+}
+
+/** Accepts every waiting spectator and queues the path and each player's
+ *  state for them. The queue has room for all of these on top of the
+ *  usual SPECTATOR_QUEUE, however many players there are.
+ *
+ * @param spectators The spectators
+ * @param path The game path
+ */
+void accept_spectators(Spectators *spectators, Path *path) {
+    int fd;
+    while ((fd = accept(spectators->listener, NULL, NULL)) != -1) {
+        if (set_non_blocking(fd) == -1) {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        spectators->clients = realloc(spectators->clients,
+                sizeof(Spectator) * (spectators->count + 1));
+        Spectator *spectator = &spectators->clients[spectators->count];
+        spectators->count += 1;
+
+        // room for the joining events on top of the usual queue
+        spectator->fd = fd;
+        spectator->queued = 0;
+        spectator->skipped = 0;
+        spectator->capacity = SPECTATOR_QUEUE +
+                strlen(spectators->givenPath) + strlen("PATH \n") +
+                (SPECTATOR_AT_LENGTH + 1) * (size_t) path->playersInGame;
+        spectator->queue = malloc(spectator->capacity);
+
+        spectator->queued = snprintf(spectator->queue, spectator->capacity,
+                "PATH %s\n", spectators->givenPath);
+        for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+            char event[SPECTATOR_AT_LENGTH + 2];
+            int length = format_player(path->players[playerId], event,
+                    sizeof(event));
+            queue_event(spectator, event, length);
+        }
+    }
+}
+
+/** Writes as much of each spectator's queue as their socket will take
+ *  without blocking, dropping spectators that have gone away.
+ *
+ * @param spectators The spectators
+ */
+void flush_spectators(Spectators *spectators) {
+    for (int index = spectators->count - 1; index >= 0; --index) {
+        Spectator *spectator = &spectators->clients[index];
+        if (spectator->queued == 0) {
+            continue;
+        }
+
+        ssize_t written = send(spectator->fd, spectator->queue,
+                spectator->queued, MSG_NOSIGNAL);
+        if (written == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                drop_spectator(spectators, index);
+            }
+            continue;
+        }
+        count_bytes(CHANNEL_SPECTATORS, written);
+        spectator->queued -= written;
+        memmove(spectator->queue, &spectator->queue[written],
+                spectator->queued);
+    }
+}
+
+/** Sends a TURN event to every spectator, then lets in anyone waiting to
+ *  join. Spectators with a full queue skip
+ *  the event, and are dropped once they have skipped SPECTATOR_MAX_SKIPS in
+ *  a row.
+ *
+ * @param spectators The spectators
+ * @param path The game path
+ * @param player The player who just moved
+ * @param points The player's change in points
+ * @param money The player's change in money
+ * @param card The card the player drew, or 0
+ */
+void spectate_turn(Spectators *spectators, Path *path, Player *player,
+        int points, int money, int card) {
+    spectators->turn += 1;
+
+    char event[128];
+    int length = snprintf(event, sizeof(event), "TURN %d,%d,%d,%d,%d,%d\n",
+            spectators->turn, player->id, player->siteNumber, points, money,
+            card);
+
+    for (int index = spectators->count - 1; index >= 0; --index) {
+        Spectator *spectator = &spectators->clients[index];
+        if (!queue_event(spectator, event, length) &&
+                spectator->skipped > SPECTATOR_MAX_SKIPS) {
+            drop_spectator(spectators, index);
+        }
+    }
+
+    // anyone joining now sees this turn in their AT events
+    accept_spectators(spectators, path);
+    flush_spectators(spectators);
+}
+
+/** Sends the final scores to every spectator, makes one last attempt to
+ *  write their queues and frees the spectators.
+ *
+ * @param spectators The spectators
+ * @param path The game path
+ */
+void spectate_end(Spectators *spectators, Path *path) {
+    accept_spectators(spectators, path);
+
+    char event[32 + 12 * path->playersInGame];
+    int length = snprintf(event, sizeof(event), "SCORES ");
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        length += snprintf(&event[length], sizeof(event) - length, "%d%s",
+                final_score(path->players[playerId]),
+                playerId == path->playersInGame - 1 ? "\n" : ",");
+    }
+
+    for (int index = 0; index < spectators->count; ++index) {
+        queue_event(&spectators->clients[index], event, length);
+    }
+    flush_spectators(spectators);
+    free_spectators(spectators);
+}
+
+/** Drops every spectator, closes the socket and frees the spectators.
+ *
+ * @param spectators The spectators
+ */
+void free_spectators(Spectators *spectators) {
+    while (spectators->count > 0) {
+        drop_spectator(spectators, spectators->count - 1);
+    }
+    close(spectators->listener);
+    remove_stale_socket(spectators->socketPath);
+    free(spectators->socketPath);
+    free(spectators->clients);
+    free(spectators);
+}
@@ -0,0 +1,74 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// set on the dealer to the Unix socket path spectators connect to
+#define SPECTATE_ENV "DEALER_SPECTATE"
+
+// bytes of events a spectator may fall behind by before frames are skipped
+#define SPECTATOR_QUEUE 8192
+
+// the longest AT event: "AT " and eleven ints with separators
+#define SPECTATOR_AT_LENGTH (3 + 11 * 12)
+
+// frames in a row a spectator may skip before it is dropped
+#define SPECTATOR_MAX_SKIPS 64
+
+struct Path;
+struct Player;
+
+/** A connected spectator and the events it has yet to be sent. **/
+typedef struct Spectator {
+    // the spectator's socket, non-blocking
+    int fd;
+
+    // events not yet written, and how many bytes of them there are
+    char *queue;
+    size_t queued;
+    size_t capacity;
+
+    // frames skipped in a row because the queue was full
+    int skipped;
+} Spectator;
+
+/** The spectator socket and everyone connected to it.
+ *
+ *  Each spectator is sent, one event per line:
+ *  PATH <path>           on connecting
+ *  AT id,site,points,money,V1,V2,A,B,C,D,E
+ *                        for each player on connecting
+ *  TURN n,id,site,points,money,card
+ *                        after each move, with HAP's changes in points,
+ *                        money and the card drawn
+ *  SCORES s0,s1,...      when the game ends
+ */
+typedef struct Spectators {
+    // the listening socket, non-blocking
+    int listener;
+    char *socketPath;
+
+    // the contents of the path file, sent to new spectators
+    char *givenPath;
+
+    // the number of moves made so far
+    int turn;
+
+    Spectator *clients;
+    int count;
+} Spectators;
+
+Spectators *create_spectators(char *givenPath);
+void spectate_turn(Spectators *spectators, struct Path *path,
+        struct Player *player, int points, int money, int card);
+void spectate_end(Spectators *spectators, struct Path *path);
+void free_spectators(Spectators *spectators);
+
+#endif
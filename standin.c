@@ -0,0 +1,288 @@
+#include "standin.h"
+
+/** Reads a setting's value as a number in the given range.
+ *
+ * @param value The value
+ * @param min The smallest value allowed
+ * @param max The largest value allowed
+ * @param number Set to the number
+ * @return true if the value is a number in range
+ */
+static bool read_number(const char *value, double min, double max,
+        double *number) {
+    char *end;
+    *number = strtod(value, &end);
+    return *value != '\0' && *end == '\0' && *number >= min &&
+            *number <= max;
+}
+
+/** Reads recorded think times, one number of milliseconds per line.
+ *
+ * @param standin The stand-in, given the times
+ * @param fileName The file of times
+ * @return true if the file was read and has at least one time
+ */
+static bool load_replay(Standin *standin, const char *fileName) {
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        return false;
+    }
+    char *line = NULL;
+    size_t lineSize = 0;
+    bool valid = true;
+    while (valid && getline(&line, &lineSize, file) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') {
+            continue;
+        }
+        double millis;
+        valid = read_number(line, 0, 1e9, &millis);
+        standin->replayMillis = realloc(standin->replayMillis,
+                sizeof(double) * (standin->numReplay + 1));
+        standin->replayMillis[standin->numReplay] = millis;
+        standin->numReplay += 1;
+    }
+    free(line);
+    fclose(file);
+    return valid && standin->numReplay > 0;
+}
+
+/** Applies one key=value setting.
+ *
+ * @param standin The stand-in
+ * @param key The setting's name
+ * @param value The setting's value
+ * @param seed Set by the seed setting
+ * @return true if the setting is known and its value valid
+ */
+static bool apply_setting(Standin *standin, const char *key,
+        const char *value, uint64_t *seed) {
+    double number;
+    if (strcmp(key, "strategy") == 0) {
+        standin->strategy = value[0];
+        return (value[0] == 'A' || value[0] == 'B') && value[1] == '\0';
+    }
+    if (strcmp(key, "spread") == 0) {
+        if (strcmp(value, "fixed") == 0) {
+            standin->spread = SPREAD_FIXED;
+        } else if (strcmp(value, "uniform") == 0) {
+            standin->spread = SPREAD_UNIFORM;
+        } else if (strcmp(value, "exp") == 0) {
+            standin->spread = SPREAD_EXPONENTIAL;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    if (strcmp(key, "replay") == 0) {
+        return load_replay(standin, value);
+    }
+    if (strcmp(key, "think") == 0 && read_number(value, 0, 1e9, &number)) {
+        standin->thinkMillis = number;
+    } else if (strcmp(key, "partial") == 0 &&
+            read_number(value, 0, 1e9, &number)) {
+        standin->partialMillis = number;
+    } else if (strcmp(key, "invalid") == 0 &&
+            read_number(value, 0, 1, &number)) {
+        standin->invalidRate = number;
+    } else if (strcmp(key, "oversize") == 0 &&
+            read_number(value, 0, 1, &number)) {
+        standin->oversizeRate = number;
+    } else if (strcmp(key, "bytes") == 0 &&
+            read_number(value, 16, INT_MAX, &number)) {
+        standin->oversizeBytes = (int) number;
+    } else if (strcmp(key, "burst") == 0 &&
+            read_number(value, 1, 1024, &number)) {
+        standin->burst = (int) number;
+    } else if (strcmp(key, "exit") == 0 &&
+            read_number(value, 0, INT_MAX, &number)) {
+        standin->exitTurn = (int) number;
+    } else if (strcmp(key, "seed") == 0 &&
+            read_number(value, 0, UINT32_MAX, &number)) {
+        *seed = (uint64_t) number;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** Makes a stand-in from its settings, eg
+ *  "strategy=B,think=20,spread=exp,burst=3,invalid=0.01". Anything not
+ *  set plays like Player A with no delay.
+ *
+ * @param settings The settings
+ * @param playerId The player's ID, which varies the random choices
+ * @return The stand-in, or NULL if a setting is unknown or invalid
+ */
+Standin *parse_standin(const char *settings, int playerId) {
+    Standin *standin = malloc(sizeof(Standin));
+    standin->strategy = 'A';
+    standin->thinkMillis = 0;
+    standin->spread = SPREAD_FIXED;
+    standin->replayMillis = NULL;
+    standin->numReplay = 0;
+    standin->burst = 1;
+    standin->partialMillis = 0;
+    standin->invalidRate = 0;
+    standin->oversizeRate = 0;
+    standin->oversizeBytes = DEFAULT_OVERSIZE_BYTES;
+    standin->exitTurn = 0;
+    standin->turn = 0;
+    uint64_t seed = 0;
+
+    char *copy = strdup(settings);
+    char *save;
+    bool valid = true;
+    for (char *setting = strtok_r(copy, ",", &save);
+            valid && setting != NULL; setting = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(setting, '=');
+        valid = value != NULL;
+        if (valid) {
+            *value = '\0';
+            valid = apply_setting(standin, setting, value + 1, &seed);
+        }
+    }
+    free(copy);
+    if (!valid) {
+        free(standin->replayMillis);
+        free(standin);
+        return NULL;
+    }
+
+    standin->random = seed ^ ((uint64_t) playerId << 32);
+    return standin;
+}
+
+/** Returns a random number in [0, 1). **/
+static double next_uniform(Standin *standin) {
+    return (next_random(&standin->random) >> 11) * 0x1.0p-53;
+}
+
+/** Returns how long to think this turn, in milliseconds.
+ *
+ * @param standin The stand-in
+ * @return The think time
+ */
+double think_millis(Standin *standin) {
+    if (standin->replayMillis != NULL) {
+        return standin->replayMillis[(standin->turn - 1) %
+                standin->numReplay];
+    }
+    switch (standin->spread) {
+        case SPREAD_UNIFORM:
+            return 2 * standin->thinkMillis * next_uniform(standin);
+        case SPREAD_EXPONENTIAL:
+            return -standin->thinkMillis * log(1 - next_uniform(standin));
+        case SPREAD_FIXED:
+            break;
+    }
+    return standin->thinkMillis;
+}
+
+/** Sleeps for the given number of milliseconds. **/
+static void pause_millis(double millis) {
+    if (millis <= 0) {
+        return;
+    }
+    struct timespec wait;
+    wait.tv_sec = (time_t) (millis / 1000);
+    wait.tv_nsec = (long) ((millis - wait.tv_sec * 1000.0) * 1e6);
+    while (nanosleep(&wait, &wait) == -1) {
+    }
+}
+
+/** Sends a reply to YT, split into the stand-in's number of writes with
+ *  its pause between them.
+ *
+ * @param standin The stand-in
+ * @param reply The reply, ending in a newline
+ * @param length The reply's length
+ */
+static void write_reply(Standin *standin, const char *reply, int length) {
+    int pieceLength = (length + standin->burst - 1) / standin->burst;
+    for (int written = 0; written < length; written += pieceLength) {
+        if (written > 0) {
+            pause_millis(standin->partialMillis);
+        }
+        int piece = length - written < pieceLength ? length - written :
+                pieceLength;
+        fwrite(&reply[written], 1, piece, stdout);
+        fflush(stdout);
+    }
+}
+
+/** Replies to YT the way the stand-in's settings say to: after thinking,
+ *  with its strategy's move or a bad reply, or not at all if it is to
+ *  exit this turn.
+ *
+ * @param standin The stand-in
+ * @param path The game path
+ * @param playerId The stand-in's player ID
+ */
+void standin_turn(Standin *standin, Path *path, int playerId) {
+    Speculation *speculation = &path->speculation;
+    standin->turn += 1;
+    if (standin->turn == standin->exitTurn) {
+        player_exit(NO_ERROR_PLAYER);
+    }
+    if (path->mirror != NULL) {
+        read_mirror(path->mirror, path);
+    }
+    if (!speculation->valid) {
+        work_out_move(path, playerId, standin->strategy);
+    }
+    speculation->valid = false;
+    pause_millis(think_millis(standin));
+
+    double draw = next_uniform(standin);
+    if (draw < standin->invalidRate) {
+        // staying put is never a legal move
+        char reply[16];
+        int length = snprintf(reply, sizeof(reply), "DO%d\n",
+                path->players[playerId]->siteNumber);
+        write_reply(standin, reply, length);
+    } else if (draw < standin->invalidRate + standin->oversizeRate) {
+        // the padding makes the move a protocol error for the dealer
+        int length = standin->oversizeBytes;
+        char *reply = malloc(length);
+        memset(reply, ' ', length);
+        memcpy(reply, speculation->reply, speculation->replyLength - 1);
+        reply[length - 1] = '\n';
+        write_reply(standin, reply, length);
+        free(reply);
+    } else {
+        write_reply(standin, speculation->reply, speculation->replyLength);
+    }
+}
+
+/** Main loop for a stand-in, which follows the game as a player would.
+ *
+ * @param standin The stand-in
+ * @param path The game path
+ * @param playerId The stand-in's player ID
+ */
+void run_standin(Standin *standin, Path *path, int playerId) {
+    path->mirror = attach_mirror(path);
+    path->log = open_log(stderr);
+    char processName[32];
+    snprintf(processName, sizeof(processName), "stand-in %d (%c)",
+            playerId, standin->strategy);
+    start_trace(processName);
+    print_path(path, path->log);
+    fflush(path->log);
+    if (path->mirror == NULL) {
+        speculate_move(path, playerId, standin->strategy);
+    }
+    while (true) {
+        char *input = read_line(stdin);
+        if (strcmp(input, "\a") == 0) {
+            player_exit(PLAYER_COMMUNICATION_ERROR);
+        }
+        if (strcmp(input, "YT") == 0) {
+            standin_turn(standin, path, playerId);
+        } else if (check_input(input, path, playerId, standin->strategy)) {
+            player_exit(PLAYER_COMMUNICATION_ERROR);
+        }
+        free(input);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef STANDIN_H
+#define STANDIN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include "util.h"
+#include "path.h"
+
+// set to a stand-in's behaviour, as comma separated key=value settings;
+// STANDIN_<id> is used instead for the player with that ID if it is set
+#define STANDIN_ENV "STANDIN"
+
+// how long an oversized reply is when no length is given
+#define DEFAULT_OVERSIZE_BYTES 65536
+
+/** How a stand-in's think time varies from turn to turn. **/
+typedef enum ThinkSpread {
+    // always the think time
+    SPREAD_FIXED,
+    // evenly between none and twice the think time
+    SPREAD_UNIFORM,
+    // exponentially, averaging the think time
+    SPREAD_EXPONENTIAL
+} ThinkSpread;
+
+/** How a stand-in player behaves, read from its settings. **/
+typedef struct Standin {
+    // the strategy moves are made with, 'A' or 'B'
+    char strategy;
+
+    // milliseconds to wait before replying to YT, and how it varies
+    double thinkMillis;
+    ThinkSpread spread;
+
+    // recorded think times in milliseconds, used in turn and from the
+    // start again once used up, instead of thinkMillis; NULL if none
+    double *replayMillis;
+    int numReplay;
+
+    // how many writes a reply is split into, and how long to wait between
+    // them, leaving a partial line in the pipe
+    int burst;
+    double partialMillis;
+
+    // the chance each turn of replying with an illegal move, or with a
+    // legal move padded to oversizeBytes, which the dealer rejects
+    double invalidRate;
+    double oversizeRate;
+    int oversizeBytes;
+
+    // the turn to exit on without replying, or 0 to play to the end
+    int exitTurn;
+
+    // draws the random choices, seeded from the settings and the player ID
+    // so that a run can be repeated
+    uint64_t random;
+    int turn;
+} Standin;
+
+Standin *parse_standin(const char *settings, int playerId);
+double think_millis(Standin *standin);
+void standin_turn(Standin *standin, Path *path, int playerId);
+void run_standin(Standin *standin, Path *path, int playerId);
+
+#endif
@@ -0,0 +1,246 @@
+#include "stats.h"
+
+/** Adds to a counter shared with other processes.
+ *
+ * @param counter The shared counter
+ * @param amount How much to add
+ */
+static void add_shared(uint64_t *counter, uint64_t amount) {
+    if (amount != 0) {
+        __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+    }
+}
+
+/** Creates the statistics shared by every game if STATS_ENV is set. The
+ *  mapping is inherited by games forked after this.
+ *
+ * @return The shared statistics, or NULL if they are off or unavailable.
+ */
+Stats *create_stats(void) {
+    if (getenv(STATS_ENV) == NULL) {
+        return NULL;
+    }
+
+    Stats *total = mmap(NULL, sizeof(Stats), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (total == MAP_FAILED) {
+        return NULL;
+    }
+    // anonymous mappings start zeroed
+    return total;
+}
+
+/** Starts counting a game.
+ *
+ * @param total The shared statistics, or NULL if they are off
+ * @param seatNames The program playing each seat
+ * @param numSeats The number of players in the game
+ * @return The game's counts, or NULL if statistics are off.
+ */
+GameStats *start_game_stats(Stats *total, char **seatNames, int numSeats) {
+    if (total == NULL) {
+        return NULL;
+    }
+    GameStats *stats = calloc(1, sizeof(GameStats));
+    stats->total = total;
+    stats->seatNames = seatNames;
+    stats->numSeats = numSeats;
+    return stats;
+}
+
+/** Counts a move ending on the given site.
+ *
+ * @param stats The game's counts
+ * @param siteNumber The site moved to
+ */
+void count_move(GameStats *stats, int siteNumber) {
+    stats->turns += 1;
+    stats->visits[siteNumber < STATS_MAX_SITES ? siteNumber :
+            STATS_MAX_SITES] += 1;
+}
+
+/** Counts a card drawn at a Ri site.
+ *
+ * @param stats The game's counts
+ * @param card The card drawn as sent in HAP, 1 to 5, or 0 for none
+ */
+void count_card(GameStats *stats, int card) {
+    if (card >= 1 && card <= STATS_CARDS) {
+        stats->cards[card - 1] += 1;
+    }
+}
+
+/** Returns true if the slot, claimed with the same name hash, is for the
+ *  program. Waits briefly for whoever claimed the slot to finish naming
+ *  it, and counts it as another program's if they don't.
+ *
+ * @param slot The slot
+ * @param name The program name
+ * @return true if the slot's name matches
+ */
+static bool slot_named(StrategyStats *slot, const char *name) {
+    for (int wait = 0; !__atomic_load_n(&slot->named, __ATOMIC_ACQUIRE);
+            ++wait) {
+        if (wait == STATS_NAME_WAITS) {
+            return false;
+        }
+        sched_yield();
+    }
+    return strncmp(slot->name, name, STATS_NAME_LENGTH - 1) == 0;
+}
+
+/** Finds the shared slot for a program, claiming an unused one if it has
+ *  not been seen before. The hash picks the slot, and the name has to
+ *  match as well, as different programs can share a hash.
+ *
+ * @param total The shared statistics
+ * @param name The program name
+ * @return The slot, or NULL if every slot is used by another program.
+ */
+static StrategyStats *find_strategy(Stats *total, const char *name) {
+    uint64_t hash = hash_bytes(name, strlen(name));
+    // 0 marks an unused slot
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    for (int probe = 0; probe < STATS_MAX_STRATEGIES; ++probe) {
+        StrategyStats *slot = &total->strategies[(hash + probe) %
+                STATS_MAX_STRATEGIES];
+        uint64_t seen = 0;
+        if (__atomic_compare_exchange_n(&slot->nameHash, &seen, hash, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            snprintf(slot->name, STATS_NAME_LENGTH, "%s", name);
+            __atomic_store_n(&slot->named, 1, __ATOMIC_RELEASE);
+            return slot;
+        }
+        if (seen == hash && slot_named(slot, name)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/** Counts the final scores and merges the game's counts into the shared
+ *  statistics. Every top scorer counts as a winner.
+ *
+ * @param stats The game's counts
+ * @param scores The final score of each seat
+ */
+void finish_game_stats(GameStats *stats, const int *scores) {
+    Stats *total = stats->total;
+    int best = scores[0];
+    for (int seat = 1; seat < stats->numSeats; ++seat) {
+        if (scores[seat] > best) {
+            best = scores[seat];
+        }
+    }
+
+    for (int seat = 0; seat < stats->numSeats; ++seat) {
+        StrategyStats *strategy = find_strategy(total,
+                stats->seatNames[seat]);
+        if (strategy == NULL) {
+            add_shared(&total->untrackedSeats, 1);
+            continue;
+        }
+        int score = scores[seat] < 0 ? 0 : scores[seat];
+        add_shared(&strategy->seats, 1);
+        add_shared(&strategy->wins, scores[seat] == best ? 1 : 0);
+        add_shared(&strategy->scoreTotal, score);
+        add_shared(&strategy->scores[score < STATS_MAX_SCORE ? score :
+                STATS_MAX_SCORE], 1);
+    }
+
+    add_shared(&total->games, 1);
+    add_shared(&total->turns, stats->turns);
+    for (int site = 0; site <= STATS_MAX_SITES; ++site) {
+        add_shared(&total->visits[site], stats->visits[site]);
+    }
+    for (int card = 0; card < STATS_CARDS; ++card) {
+        add_shared(&total->cards[card], stats->cards[card]);
+    }
+    memset(stats->visits, 0, sizeof(stats->visits));
+    memset(stats->cards, 0, sizeof(stats->cards));
+    stats->turns = 0;
+}
+
+/** Returns the lowest score at or above the given fraction of a strategy's
+ *  seats. Scores of STATS_MAX_SCORE or more are reported as
+ *  STATS_MAX_SCORE.
+ *
+ * @param strategy The strategy's results
+ * @param fraction The quantile, 0 to 1
+ * @return The score
+ */
+static int score_quantile(StrategyStats *strategy, double fraction) {
+    uint64_t rank = (uint64_t) (fraction * (strategy->seats - 1));
+    uint64_t seen = 0;
+    for (int score = 0; score < STATS_MAX_SCORE; ++score) {
+        seen += strategy->scores[score];
+        if (seen > rank) {
+            return score;
+        }
+    }
+    return STATS_MAX_SCORE;
+}
+
+/** Writes the statistics as one report, a line per figure.
+ *
+ * @param total The shared statistics
+ * @param fileName Where to write the report
+ * @return true if the report was written
+ */
+bool write_stats_report(Stats *total, char *fileName) {
+    FILE *report = fopen(fileName, "w");
+    if (report == NULL) {
+        return false;
+    }
+
+    uint64_t games = __atomic_load_n(&total->games, __ATOMIC_RELAXED);
+    uint64_t turns = __atomic_load_n(&total->turns, __ATOMIC_RELAXED);
+    fprintf(report, "games %llu\n", (unsigned long long) games);
+    fprintf(report, "turns %llu\n", (unsigned long long) turns);
+    fprintf(report, "turns_per_game %.2f\n",
+            games == 0 ? 0.0 : (double) turns / games);
+
+    for (int slot = 0; slot < STATS_MAX_STRATEGIES; ++slot) {
+        StrategyStats *strategy = &total->strategies[slot];
+        if (strategy->nameHash == 0 || strategy->seats == 0) {
+            continue;
+        }
+        fprintf(report, "strategy %s seats %llu wins %llu win_rate %.4f "
+                "mean_score %.2f p50 %d p90 %d p99 %d\n", strategy->name,
+                (unsigned long long) strategy->seats,
+                (unsigned long long) strategy->wins,
+                (double) strategy->wins / strategy->seats,
+                (double) strategy->scoreTotal / strategy->seats,
+                score_quantile(strategy, 0.5), score_quantile(strategy, 0.9),
+                score_quantile(strategy, 0.99));
+    }
+    if (total->untrackedSeats != 0) {
+        fprintf(report, "untracked_seats %llu\n",
+                (unsigned long long) total->untrackedSeats);
+    }
+
+    fprintf(report, "cards");
+    for (int card = 0; card < STATS_CARDS; ++card) {
+        fprintf(report, " %c %llu", 'A' + card,
+                (unsigned long long) total->cards[card]);
+    }
+    fprintf(report, "\n");
+
+    // sites never visited are left out; the last bucket is every site past
+    // STATS_MAX_SITES - 1
+    fprintf(report, "visits");
+    for (int site = 0; site <= STATS_MAX_SITES; ++site) {
+        if (total->visits[site] != 0) {
+            fprintf(report, " %d%s:%llu", site,
+                    site == STATS_MAX_SITES ? "+" : "",
+                    (unsigned long long) total->visits[site]);
+        }
+    }
+    fprintf(report, "\n");
+
+    fclose(report);
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "util.h"
+
+// set on the dealer to the file the statistics report is written to
+#define STATS_ENV "DEALER_STATS"
+
+// distinct player programs tracked; seats of any more are only counted
+#define STATS_MAX_STRATEGIES 32
+#define STATS_NAME_LENGTH 64
+
+// times a program waits for another to finish naming a slot it has just
+// claimed before moving on to the next slot
+#define STATS_NAME_WAITS 1000
+
+// sites and scores past these share the last bucket
+#define STATS_MAX_SITES 256
+#define STATS_MAX_SCORE 256
+
+// cards in a hand, matching NUM_CARDS in path.h
+#define STATS_CARDS 5
+
+/** The results of every seat played by one player program. **/
+typedef struct StrategyStats {
+    // hash of the program name, 0 while the slot is unused, and the name,
+    // cut to fit, which is only complete once named is set
+    uint64_t nameHash;
+    char name[STATS_NAME_LENGTH];
+    int named;
+
+    uint64_t seats;
+    uint64_t wins;
+    uint64_t scoreTotal;
+
+    // how many seats ended on each score; quantiles are read from this
+    uint64_t scores[STATS_MAX_SCORE + 1];
+} StrategyStats;
+
+/** Statistics over every game run, shared between the processes running
+ *  them. Only ever added to, with relaxed atomics.
+ */
+typedef struct Stats {
+    uint64_t games;
+    uint64_t turns;
+
+    // moves ending on each site, and cards drawn of each kind
+    uint64_t visits[STATS_MAX_SITES + 1];
+    uint64_t cards[STATS_CARDS];
+
+    // seats not counted against a strategy as the table was full
+    uint64_t untrackedSeats;
+
+    StrategyStats strategies[STATS_MAX_STRATEGIES];
+} Stats;
+
+/** One game's counts, kept privately and merged into the shared Stats
+ *  when the game ends so games never contend while they run.
+ */
+typedef struct GameStats {
+    Stats *total;
+
+    // the program playing each seat
+    char **seatNames;
+    int numSeats;
+
+    uint64_t turns;
+    uint64_t visits[STATS_MAX_SITES + 1];
+    uint64_t cards[STATS_CARDS];
+} GameStats;
+
+Stats *create_stats(void);
+GameStats *start_game_stats(Stats *total, char **seatNames, int numSeats);
+void count_move(GameStats *stats, int siteNumber);
+void count_card(GameStats *stats, int card);
+void finish_game_stats(GameStats *stats, const int *scores);
+bool write_stats_report(Stats *total, char *fileName);
+
+#endif
@@ -0,0 +1,60 @@
+#include "trace.h"
+
+FILE *traceFile = NULL;
+
+/** Finishes the trace when the process exits. **/
+static void close_trace(void) {
+    if (traceFile != NULL) {
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+}
+
+/** Starts this process's trace if TRACE_ENV is set. The trace is written
+ *  to trace.<pid>.json in that directory, in the trace-event array format
+ *  with the closing bracket left off, as it is allowed to be. Timestamps
+ *  come from the monotonic clock, which every process shares, so the
+ *  traces of one game can be merged into a single timeline with
+ *
+ *  (echo '['; tail -q -n +2 trace.*.json) > game.json
+ *
+ * @param processName The name the process is shown with
+ */
+void start_trace(const char *processName) {
+    char *directory = getenv(TRACE_ENV);
+    if (directory == NULL || traceFile != NULL) {
+        return;
+    }
+
+    char fileName[strlen(directory) + 32];
+    snprintf(fileName, sizeof(fileName), "%s/trace.%d.json", directory,
+            (int) getpid());
+    traceFile = fopen(fileName, "w");
+    if (traceFile == NULL) {
+        return;
+    }
+    setvbuf(traceFile, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+    atexit(close_trace);
+
+    int pid = (int) getpid();
+    fprintf(traceFile, "[\n{\"name\":\"process_name\",\"ph\":\"M\","
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", pid, pid,
+            processName);
+}
+
+/** Writes one event to the trace.
+ *
+ * @param name The phase of the turn
+ * @param phase 'B' at the start of the phase, 'E' at its end
+ * @param player The player whose turn it is
+ */
+void trace_event(const char *name, char phase, int player) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int pid = (int) getpid();
+    fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03ld,"
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"player\":%d}},\n", name, phase,
+            (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000,
+            now.tv_nsec % 1000, pid, pid, player);
+}
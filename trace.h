@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+// static probes for perf and bpftrace, where systemtap's header is around:
+// csse2310:phase__begin and csse2310:phase__end, with the phase's name
+// and the player as arguments
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TRACE_PROBE(probe, name, player) \
+        DTRACE_PROBE2(csse2310, probe, name, player)
+#endif
+#endif
+#ifndef TRACE_PROBE
+#define TRACE_PROBE(probe, name, player)
+#endif
+
+// set on the dealer to a directory each process writes a trace to; the
+// players inherit it
+#define TRACE_ENV "DEALER_TRACE"
+
+// bytes of events buffered before a trace is written out
+#define TRACE_BUFFER_SIZE (1 << 16)
+
+// the open trace, or NULL if tracing is off
+extern FILE *traceFile;
+
+/** Marks the start and end of a phase of a turn. Costs a probe, which is a
+ *  nop unless attached to, and a branch when tracing is off.
+ */
+#define TRACE_BEGIN(name, player) do { \
+    TRACE_PROBE(phase__begin, name, player); \
+    if (traceFile != NULL) { \
+        trace_event(name, 'B', player); \
+    } \
+} while (0)
+
+#define TRACE_END(name, player) do { \
+    TRACE_PROBE(phase__end, name, player); \
+    if (traceFile != NULL) { \
+        trace_event(name, 'E', player); \
+    } \
+} while (0)
+
+void start_trace(const char *processName);
+void trace_event(const char *name, char phase, int player);
+
+#endif
@@ -0,0 +1,144 @@
+#include "transcript.h"
+#include "metrics.h"
+
+/** Writes the value 7 bits at a time, low bits first, with the top bit of
+ *  each byte set if more follow.
+ *
+ * @param file Where to write
+ * @param value The value
+ */
+void write_varint(FILE *file, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int) (value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int) value, file);
+}
+
+/** Reads a value written by write_varint().
+ *
+ * @param file Where to read from
+ * @param value Set to the value read
+ * @return false if the file ended first.
+ */
+bool read_varint(FILE *file, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int next = fgetc(file);
+        if (next == EOF) {
+            return false;
+        }
+        *value |= (uint64_t) (next & 0x7F) << shift;
+        if ((next & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Maps small negative and positive numbers to small varints.
+ *
+ * @param value The value
+ * @return 0, -1, 1, -2, 2... as 0, 1, 2, 3, 4...
+ */
+uint64_t zigzag(int value) {
+    return value < 0 ? ((uint64_t) -(int64_t) value << 1) - 1 :
+            (uint64_t) value << 1;
+}
+
+/** Undoes zigzag().
+ *
+ * @param value The zigzag encoded value
+ * @return The value
+ */
+int unzigzag(uint64_t value) {
+    return (value & 1) ? -(int) (value >> 1) - 1 : (int) (value >> 1);
+}
+
+/** Hashes the cards of the deck in drawing order.
+ *
+ * @param deck The deck, before any cards have been drawn
+ * @return The FNV-1a hash of the cards
+ */
+uint64_t hash_deck(Deck *deck) {
+    char cards[deck->count];
+    Card *card = deck->topCard;
+    for (int i = 0; i < deck->count; ++i) {
+        cards[i] = card->value;
+        card = card->nextCard;
+    }
+    return hash_bytes(cards, deck->count);
+}
+
+/** Starts a transcript in the file named by TRANSCRIPT_ENV.
+ *
+ * @param givenPath The contents of the path file
+ * @param deck The deck, before any cards have been drawn
+ * @param numPlayers The number of players
+ * @return The transcript, or NULL if transcripts are off or the file
+ * can't be written.
+ */
+Transcript *create_transcript(char *givenPath, Deck *deck, int numPlayers) {
+    char *fileName = getenv(TRANSCRIPT_ENV);
+    if (fileName == NULL) {
+        return NULL;
+    }
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    Transcript *transcript = malloc(sizeof(Transcript));
+    transcript->file = file;
+
+    fputs(TRANSCRIPT_MAGIC, file);
+    write_varint(file, TRANSCRIPT_VERSION);
+    write_varint(file, numPlayers);
+    write_varint(file, strlen(givenPath));
+    fputs(givenPath, file);
+
+    uint64_t deckHash = hash_deck(deck);
+    for (int byte = 0; byte < 8; ++byte) {
+        fputc((int) (deckHash >> (8 * byte)) & 0xFF, file);
+    }
+    // so a generated deck can be made again
+    if (deck->seed == NULL) {
+        write_varint(file, 0);
+    } else {
+        write_varint(file, strlen(deck->seed));
+        fputs(deck->seed, file);
+    }
+
+    return transcript;
+}
+
+/** Records a move.
+ *
+ * @param transcript The transcript
+ * @param playerId The player who moved
+ * @param steps How many sites the player moved
+ * @param points The player's change in points
+ * @param money The player's change in money
+ * @param card The card drawn, or 0
+ */
+void record_turn(Transcript *transcript, int playerId, int steps, int points,
+        int money, int card) {
+    write_varint(transcript->file, playerId + 1);
+    write_varint(transcript->file, zigzag(steps));
+    write_varint(transcript->file, zigzag(points));
+    write_varint(transcript->file, zigzag(money));
+    write_varint(transcript->file, card);
+}
+
+/** Records the end of the game and closes the transcript.
+ *
+ * @param transcript The transcript
+ */
+void record_end(Transcript *transcript) {
+    write_varint(transcript->file, 0);
+    long length = ftell(transcript->file);
+    if (fclose(transcript->file) == 0 && length > 0) {
+        count_bytes(CHANNEL_TRANSCRIPT, length);
+    }
+    transcript->file = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef TRANSCRIPT_H
+#define TRANSCRIPT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "util.h"
+#include "deck.h"
+
+// set on the dealer to a file to write a compact transcript to instead of
+// printing the board
+#define TRANSCRIPT_ENV "DEALER_TRANSCRIPT"
+
+// the first bytes of every transcript, then the format version
+#define TRANSCRIPT_MAGIC "2310T"
+#define TRANSCRIPT_VERSION 2
+
+/** A compact record of a game, from which 2310replay prints the dealer's
+ *  output.
+ *
+ *  Header: TRANSCRIPT_MAGIC, then as varints the version, the number of
+ *  players and the length of the path file contents, then the path file
+ *  contents and the 8 byte FNV-1a hash of the deck, little endian, then a
+ *  varint length and the deck's full seed:... spec, or 0 for a deck read
+ *  from a file. Version 1 transcripts have no seed.
+ *
+ *  Each move is five varints: the player ID + 1, and the zigzag encoded
+ *  change in site, points and money, then the card drawn. A player ID
+ *  varint of 0 ends the game.
+ */
+typedef struct Transcript {
+    FILE *file;
+} Transcript;
+
+Transcript *create_transcript(char *givenPath, Deck *deck, int numPlayers);
+void record_turn(Transcript *transcript, int playerId, int steps, int points,
+        int money, int card);
+void record_end(Transcript *transcript);
+
+void write_varint(FILE *file, uint64_t value);
+bool read_varint(FILE *file, uint64_t *value);
+uint64_t zigzag(int value);
+int unzigzag(uint64_t value);
+uint64_t hash_deck(Deck *deck);
+
+#endif
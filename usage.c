@@ -0,0 +1,106 @@
+#include "usage.h"
+#include "path.h"
+
+/** Returns the nanoseconds since the given time on the monotonic clock.
+ *
+ * @param since The earlier time
+ * @return The nanoseconds elapsed
+ */
+int64_t elapsed_nanos(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) (now.tv_sec - since->tv_sec) * 1000000000 +
+            (now.tv_nsec - since->tv_nsec);
+}
+
+/** Reaps whichever players have exited, without waiting for the rest,
+ *  recording how each ended and what it used.
+ *
+ * @param path The game path
+ * @return The number of players still to be reaped
+ */
+int reap_exited_players(Path *path) {
+    int waiting = 0;
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        SeatUsage *seat = &path->usage[playerId];
+        if (seat->reaped || seat->pid <= 0) {
+            continue;
+        }
+        pid_t reaped = wait4(seat->pid, &seat->status, WNOHANG,
+                &seat->usage);
+        if (reaped == seat->pid) {
+            seat->reaped = true;
+        } else if (reaped == -1 && errno != EINTR) {
+            // not our child, so it can never be reaped here
+            seat->pid = -seat->pid;
+        } else {
+            waiting += 1;
+        }
+    }
+    return waiting;
+}
+
+/** Returns a time from rusage in microseconds.
+ *
+ * @param time The time
+ * @return The microseconds
+ */
+static long long micros(const struct timeval *time) {
+    return (long long) time->tv_sec * 1000000 + time->tv_usec;
+}
+
+/** Appends a line per seat describing what the player used. Each line is
+ *  written whole, so games sharing the file do not interleave:
+ *
+ *  dealer D game G dealer_exit X seat N program P pid N exit E user_us N
+ *  system_us N max_rss_kb N voluntary_switches N involuntary_switches N
+ *  think_us N moves N
+ *
+ *  D is the dealer's pid and G numbers the games it has run from 1, so
+ *  the games of dealers sharing the file are told apart. dealer_exit is
+ *  the code the dealer exits with for the game. exit is the player's exit
+ *  code, 128 + the signal for a killed player, or -1 if the player was not
+ *  reaped, in which case its usage is 0.
+ *
+ * @param path The game path
+ * @param fileName The file to append to
+ * @param gameId The game's number in the dealer
+ * @param dealerExit The dealer's exit code for the game
+ */
+void write_usage(Path *path, char *fileName, int gameId, int dealerExit) {
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) {
+        return;
+    }
+
+    for (int playerId = 0; playerId < path->playersInGame; ++playerId) {
+        SeatUsage *seat = &path->usage[playerId];
+        struct rusage *usage = &seat->usage;
+        int exitCode = -1;
+        if (!seat->reaped) {
+            memset(usage, 0, sizeof(*usage));
+        } else if (WIFEXITED(seat->status)) {
+            exitCode = WEXITSTATUS(seat->status);
+        } else {
+            exitCode = 128 + WTERMSIG(seat->status);
+        }
+
+        char line[512];
+        int length = snprintf(line, sizeof(line), "dealer %d game %d "
+                "dealer_exit %d seat %d program %s pid %d exit %d "
+                "user_us %lld system_us %lld max_rss_kb %ld "
+                "voluntary_switches %ld involuntary_switches %ld "
+                "think_us %lld moves %d\n", (int) getpid(), gameId,
+                dealerExit, playerId, path->programs[playerId],
+                (int) (seat->pid < 0 ? -seat->pid : seat->pid), exitCode,
+                micros(&usage->ru_utime), micros(&usage->ru_stime),
+                usage->ru_maxrss, usage->ru_nvcsw, usage->ru_nivcsw,
+                (long long) (seat->thinkNanos / 1000), seat->moves);
+        if (length >= (int) sizeof(line)) {
+            length = sizeof(line) - 1;
+            line[length - 1] = '\n';
+        }
+        write(fd, line, length);
+    }
+    close(fd);
+}
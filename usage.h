@@ -0,0 +1,49 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// set on the dealer to a file each seat's resource use is appended to
+#define USAGE_ENV "DEALER_USAGE"
+
+// how long the dealer waits for a game's players to exit after DONE or
+// EARLY before it gives up on reaping them
+#define REAP_TIMEOUT_MS 1000
+
+struct Path;
+
+/** What one player process cost, filled in as the game goes and when the
+ *  player is reaped.
+ */
+typedef struct SeatUsage {
+    pid_t pid;
+
+    // nanoseconds between sending YT and getting the move, summed over
+    // every turn, and how many turns that was
+    int64_t thinkNanos;
+    int moves;
+
+    // whether the process was reaped, and if so how it ended and what
+    // it used
+    bool reaped;
+    int status;
+    struct rusage usage;
+} SeatUsage;
+
+int64_t elapsed_nanos(const struct timespec *since);
+int reap_exited_players(struct Path *path);
+void write_usage(struct Path *path, char *fileName, int gameId,
+        int dealerExit);
+
+#endif
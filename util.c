@@ -1,4 +1,5 @@
 #include "util.h"
+#include "metrics.h"
 
 /** Exits the game with the error code.
  *
@@ -12,6 +13,7 @@
  * @exit code 6 - Communications error
  */
 void player_exit(PlayerErrorCode errorCode) {
+    drain_log();
     switch (errorCode) {
         case INVALID_NUM_ARGS_PLAYER:
             fprintf(stderr, "Usage: player pcount ID");
@@ -41,70 +43,53 @@ void player_exit(PlayerErrorCode errorCode) {
     exit(errorCode);
 }
 
-/** Exits the game with the error code. Reaps all children process attached.
+/** Returns the message the dealer prints for an error.
  *
- * @param errorCode The error code to exit with.
- * @exit code 0 - no error
- * @exit code 1 - Incorrect number of args
- * @exit code 2 - Invalid deck file or contents
- * @exit code 3 - Invalid path file or contents
- * @exit code 4 - Error starting one of the players
- * @exit code 5 - Communications error
+ * @param errorCode The error
+ * @return The message, which is empty for NORMAL_END and NO_ERROR
  */
-void dealer_exit(DealerErrorCode errorCode) {
+const char *dealer_error_message(DealerErrorCode errorCode) {
     switch (errorCode) {
         case INVALID_NUM_ARGS:
-            fprintf(stderr, "Usage: 2310dealer deck path p1 {p2}");
-            break;
+            return "Usage: 2310dealer deck path p1 {p2}";
         case INVALID_DECK_FILE:
-            fprintf(stderr, "Error reading deck");
-            break;
+            return "Error reading deck";
         case INVALID_PATH_FILE:
-            fprintf(stderr, "Error reading path");
-            break;
+            return "Error reading path";
         case ERROR_STARTING_PLAYER:
-            fprintf(stderr, "Error starting process");
-            break;
+            return "Error starting process";
         case COMMUNICATION_ERROR:
-            fprintf(stderr, "Communications error");
-            break;
+            return "Communications error";
         case NO_ERROR:
-            break;
         case NORMAL_END:
-            exit(NORMAL_END);
             break;
     }
-    fprintf(stderr, "\n");
+    return "";
+}
+
+/** Exits the game with the error code. Reaps all children process attached.
+ *
+ * @param errorCode The error code to exit with.
+ * @exit code 0 - no error
+ * @exit code 1 - Incorrect number of args
+ * @exit code 2 - Invalid deck file or contents
+ * @exit code 3 - Invalid path file or contents
+ * @exit code 4 - Error starting one of the players
+ * @exit code 5 - Communications error
+ */
+void dealer_exit(DealerErrorCode errorCode) {
+    count_exit(errorCode);
+    drain_log();
+    if (errorCode == NORMAL_END) {
+        exit(NORMAL_END);
+    }
+    fprintf(stderr, "%s\n", dealer_error_message(errorCode));
     fflush(stderr);
 
     wait(NULL);
     exit(errorCode);
 }
 
-/** Counts the number of chars for an int
- * param integer: the integer to have its characters counted.
- * Returns: the number of characters in the integer */
-int count_chars(int integer) {
-    int isNeg = 0;
-    if (integer < 0) {
-        isNeg = 1;
-    }
-    int real = abs(integer);
-    if (real < 10) {
-        return 1 + isNeg;
-    } else if (real > 9) {
-        return 2 + isNeg;
-    } else if (real > 99) {
-        return 3 + isNeg;
-    } else if (real > 999) {
-        return 4 + isNeg;
-    } else if (real > 9999) {
-        return 5 + isNeg;
-    }
-
-    return 0;
-}
-
 /** Reads a line from given file.
  *
  * @param file File to read from.
@@ -134,23 +119,170 @@ char *read_line(FILE *file) {
 }
 
 
-/** Creates lines with given size.
+/** Creates lines of blank columns.
  *
  * @param numLines The number of lines to create.
- * @param width How wide to make the strings.
+ * @param numColumns How many columns each line has.
+ * @param columnWidth How wide each column is.
  * @return An array of created lines.
  * **/
-char **make_empty_strings(int numLines, int width) {
+char **make_empty_strings(int numLines, int numColumns, int columnWidth) {
+    int width = numColumns * columnWidth;
     char **lines = malloc(sizeof(char *) * numLines);
     for (int i = 0; i < numLines; ++i) {
-        lines[i] = malloc(sizeof(char) * 3 * width + 1);
+        lines[i] = malloc(sizeof(char) * width + 1);
+        memset(lines[i], ' ', width);
+        lines[i][width] = 0;
+    }
+
+    return lines;
+}
+
+/** Fills in the address of a Unix socket.
+ *
+ * @param address The address to fill in
+ * @param socketPath The socket's path
+ * @return false if the path is too long for a socket address.
+ */
+bool unix_address(struct sockaddr_un *address, char *socketPath) {
+    if (strlen(socketPath) >= sizeof(address->sun_path)) {
+        return false;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socketPath);
+    return true;
+}
+
+/** Removes a socket a listener which has gone left at the given path.
+ *  Anything else there, including a socket which still takes connections,
+ *  is left alone.
+ *
+ * @param socketPath The path
+ * @return true if nothing is at the path now.
+ */
+bool remove_stale_socket(char *socketPath) {
+    struct stat status;
+    if (lstat(socketPath, &status) == -1) {
+        return errno == ENOENT;
+    }
+    struct sockaddr_un address;
+    if (!S_ISSOCK(status.st_mode) || !unix_address(&address, socketPath)) {
+        return false;
+    }
+
+    // non-blocking, so a listener with a full backlog still counts as live
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (probe == -1) {
+        return false;
+    }
+    bool refused = connect(probe, (struct sockaddr *) &address,
+            sizeof(address)) == -1 && errno == ECONNREFUSED;
+    close(probe);
+    if (!refused) {
+        return false;
+    }
+    return unlink(socketPath) == 0 || errno == ENOENT;
+}
+
+/** Listens on a Unix stream socket at the given path, replacing a socket
+ *  a previous run left there. Fails if anything else is at the path, or
+ *  another listener still has it.
+ *
+ * @param socketPath Where to make the socket
+ * @param nonBlocking Whether accept() on the socket should not block
+ * @return The listening fd, or -1 on failure.
+ */
+int listen_unix(char *socketPath, bool nonBlocking) {
+    struct sockaddr_un address;
+    if (!unix_address(&address, socketPath) ||
+            !remove_stale_socket(socketPath)) {
+        return -1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1) {
+        return -1;
+    }
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1 ||
+            listen(listener, SOMAXCONN) == -1) {
+        close(listener);
+        return -1;
+    }
+    if (nonBlocking) {
+        fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+    }
+    fcntl(listener, F_SETFD, FD_CLOEXEC);
+
+    return listener;
+}
+
+/** Hashes bytes with 64-bit FNV-1a.
+ *
+ * @param bytes The bytes to hash
+ * @param length The number of bytes
+ * @return The hash
+ */
+uint64_t hash_bytes(const char *bytes, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char) bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/** Advances a splitmix64 generator.
+ *
+ * @param state The generator's state
+ * @return The next 64 random bits
+ */
+uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
-        // we use 3 * width because each site is 3 characters
-        for (int j = 0; j < 3 * width; ++j) {
-            lines[i][j] = ' ';
+/** Reads the whole of the named file.
+ *
+ * @param fileName The file to read
+ * @param length Set to the number of bytes read
+ * @return The contents, NUL terminated, or NULL if it could not be read.
+ */
+char *read_file(char *fileName, size_t *length) {
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    size_t capacity = 4096;
+    char *contents = malloc(capacity);
+    size_t got;
+    while ((got = fread(&contents[size], 1, capacity - size - 1, file)) > 0) {
+        size += got;
+        if (size + 1 == capacity) {
+            capacity *= 2;
+            contents = realloc(contents, capacity);
         }
-        lines[i][3 * width] = 0;
     }
+    fclose(file);
 
-    return lines;
+    contents[size] = '\0';
+    *length = size;
+    return contents;
+}
+
+/** Returns the first line of the contents the way read_line() would.
+ *
+ * @param contents The file contents
+ * @return The first line
+ */
+char *first_line(char *contents) {
+    size_t length = strcspn(contents, "\n");
+    if (length == 0) {
+        return "\a";
+    }
+    return strndup(contents, length);
 }
@@ -5,8 +5,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/wait.h>
-
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include "logger.h"
+
+// the ends of a pipe() pair
+#define READ_END 0
+#define WRITE_END 1
 
 /** All error codes the dealer can send. **/
 typedef enum ErrorCodes {
@@ -33,11 +44,18 @@ typedef enum PlayerErrorCodes {
     NO_ERROR_PLAYER = -1
 } PlayerErrorCode;
 
-int count_chars(int integer);
 void player_exit(int errorCode);
+const char *dealer_error_message(DealerErrorCode errorCode);
 void dealer_exit(DealerErrorCode errorCode);
 
 char *read_line(FILE *file);
-char **make_empty_strings(int numLines, int width);
+char **make_empty_strings(int numLines, int numColumns, int columnWidth);
+bool unix_address(struct sockaddr_un *address, char *socketPath);
+bool remove_stale_socket(char *socketPath);
+int listen_unix(char *socketPath, bool nonBlocking);
+uint64_t hash_bytes(const char *bytes, size_t length);
+uint64_t next_random(uint64_t *state);
+char *read_file(char *fileName, size_t *length);
+char *first_line(char *contents);
 
 #endif
@@ -0,0 +1,226 @@
+#include "validate.h"
+
+// the number of sites checked at once by the vector path; 48 bytes
+#define SITES_PER_BLOCK 16
+
+// every pair of adjacent characters in here is accepted as a site type
+static const char *validTypes = "Mo V1 V2 Do Ri ::";
+
+/** Returns true if the site's type and capacity are valid.
+ *
+ * @param site The three characters of the site
+ * @return true if the site would be accepted by check_map_file
+ */
+static bool site_valid(const char *site) {
+    bool typeFound = false;
+    for (const char *type = validTypes; type[1] != '\0'; ++type) {
+        if (type[0] == site[0] && type[1] == site[1]) {
+            typeFound = true;
+            break;
+        }
+    }
+    if (!typeFound) {
+        return false;
+    }
+
+    // barriers have no capacity, everything else has 1 to 9
+    if (site[0] == ':' && site[1] == ':') {
+        return site[2] == '-';
+    }
+    return site[2] >= '1' && site[2] <= '9';
+}
+
+#ifdef __SSE2__
+// the types which the vector path accepts without falling back
+static const char canonicalTypes[][3] = {"Mo", "V1", "V2", "Do", "Ri", "::"};
+#define NUM_CANONICAL_TYPES \
+        ((int) (sizeof(canonicalTypes) / sizeof(canonicalTypes[0])))
+
+// phaseMasks[vector][phase] has byte n set when byte n of that vector in a
+// block is the phase'th character of a site
+static __m128i phaseMasks[SITE_WIDTH][SITE_WIDTH];
+static bool phaseMasksReady = false;
+
+/** Fills in phaseMasks. **/
+static void init_phase_masks(void) {
+    for (int vector = 0; vector < SITE_WIDTH; ++vector) {
+        for (int phase = 0; phase < SITE_WIDTH; ++phase) {
+            char mask[16];
+            for (int byte = 0; byte < 16; ++byte) {
+                mask[byte] = (16 * vector + byte) % SITE_WIDTH == phase ?
+                        -1 : 0;
+            }
+            phaseMasks[vector][phase] = _mm_loadu_si128((__m128i *) mask);
+        }
+    }
+    phaseMasksReady = true;
+}
+
+/** Returns true if all sites in the block are canonical and valid.
+ *  A false result does not mean a site is invalid, only that the block has
+ *  to be checked one site at a time.
+ *
+ * @param block SITES_PER_BLOCK sites
+ * @return true if every site in the block is valid
+ */
+static bool block_valid(const char *block) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i colon = _mm_set1_epi8(':');
+    __m128i bytes[SITE_WIDTH];
+
+    for (int vector = 0; vector < SITE_WIDTH; ++vector) {
+        bytes[vector] = _mm_loadu_si128((const __m128i *) (block +
+                16 * vector));
+    }
+
+    for (int vector = 0; vector < SITE_WIDTH; ++vector) {
+        __m128i current = bytes[vector];
+        __m128i prev = vector > 0 ? bytes[vector - 1] : zero;
+        __m128i next = vector < SITE_WIDTH - 1 ? bytes[vector + 1] : zero;
+
+        // byte n of these holds byte n + 1, n - 1 and n - 2 of current
+        __m128i next1 = _mm_or_si128(_mm_srli_si128(current, 1),
+                _mm_slli_si128(next, 15));
+        __m128i prev1 = _mm_or_si128(_mm_slli_si128(current, 1),
+                _mm_srli_si128(prev, 15));
+        __m128i prev2 = _mm_or_si128(_mm_slli_si128(current, 2),
+                _mm_srli_si128(prev, 14));
+
+        // first character of a site: the pair must be a known type
+        __m128i type = zero;
+        for (int kind = 0; kind < NUM_CANONICAL_TYPES; ++kind) {
+            type = _mm_or_si128(type, _mm_and_si128(
+                    _mm_cmpeq_epi8(current,
+                    _mm_set1_epi8(canonicalTypes[kind][0])),
+                    _mm_cmpeq_epi8(next1,
+                    _mm_set1_epi8(canonicalTypes[kind][1]))));
+        }
+
+        // third character of a site: '-' after "::", otherwise 1 to 9
+        __m128i barrier = _mm_and_si128(_mm_cmpeq_epi8(prev2, colon),
+                _mm_cmpeq_epi8(prev1, colon));
+        __m128i dash = _mm_cmpeq_epi8(current, _mm_set1_epi8('-'));
+        __m128i capacity = _mm_and_si128(
+                _mm_cmpgt_epi8(current, _mm_set1_epi8('0')),
+                _mm_cmplt_epi8(current, _mm_set1_epi8(':')));
+        __m128i limit = _mm_or_si128(_mm_and_si128(barrier, dash),
+                _mm_andnot_si128(barrier, capacity));
+
+        __m128i ok = _mm_or_si128(phaseMasks[vector][1], _mm_or_si128(
+                _mm_and_si128(phaseMasks[vector][0], type),
+                _mm_and_si128(phaseMasks[vector][2], limit)));
+        if (_mm_movemask_epi8(ok) != 0xFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+/** Finds the first site which check_map_file would reject for its type or
+ *  capacity. Checks SITES_PER_BLOCK sites at a time where SSE2 is
+ *  available.
+ *
+ * @param sites The sites of the path file, after the ';'
+ * @param numSites The number of sites to check
+ * @return The index of the first invalid site, or -1 if all are valid.
+ */
+int first_invalid_site(const char *sites, int numSites) {
+    int siteNum = 0;
+#ifdef __SSE2__
+    if (!phaseMasksReady) {
+        init_phase_masks();
+    }
+#endif
+
+    while (siteNum < numSites) {
+#ifdef __SSE2__
+        if (siteNum + SITES_PER_BLOCK <= numSites &&
+                block_valid(&sites[SITE_WIDTH * siteNum])) {
+            siteNum += SITES_PER_BLOCK;
+            continue;
+        }
+#endif
+        int blockEnd = siteNum + SITES_PER_BLOCK;
+        if (blockEnd > numSites) {
+            blockEnd = numSites;
+        }
+        for (; siteNum < blockEnd; ++siteNum) {
+            if (!site_valid(&sites[SITE_WIDTH * siteNum])) {
+                return siteNum;
+            }
+        }
+    }
+    return -1;
+}
+
+/** Reads a site whose capacity may have more than one digit. Only the six
+ *  site types are accepted, so that the digits of one site cannot run into
+ *  the type of the next.
+ *
+ * @param site The start of the site
+ * @param capacity Set to the capacity, or 0 for a barrier
+ * @return The start of the next site, or NULL if the site is invalid.
+ */
+const char *read_wide_site(const char *site, int *capacity) {
+    bool typeFound = false;
+    size_t typesLength = strlen(validTypes);
+    for (size_t i = 0; i + 1 < typesLength; i += SITE_WIDTH) {
+        const char *type = &validTypes[i];
+        if (type[0] == site[0] && type[1] == site[1]) {
+            typeFound = true;
+            break;
+        }
+    }
+    if (!typeFound) {
+        return NULL;
+    }
+
+    // barriers have no capacity, everything else has 1 to MAX_SITE_CAPACITY
+    const char *limit = &site[2];
+    if (site[0] == ':') {
+        *capacity = 0;
+        return *limit == '-' ? limit + 1 : NULL;
+    }
+    if (*limit < '1' || *limit > '9') {
+        return NULL;
+    }
+    *capacity = 0;
+    for (; *limit >= '0' && *limit <= '9'; ++limit) {
+        *capacity = *capacity * 10 + (*limit - '0');
+        if (*capacity > MAX_SITE_CAPACITY) {
+            return NULL;
+        }
+    }
+    return limit;
+}
+
+/** Finds the first card which is not one of A to E. Checks 16 cards at a
+ *  time where SSE2 is available.
+ *
+ * @param cards The cards of the deck file, after the count
+ * @param numCards The number of cards to check
+ * @return The index of the first invalid card, or -1 if all are valid.
+ */
+int first_invalid_card(const char *cards, int numCards) {
+    int cardNum = 0;
+#ifdef __SSE2__
+    __m128i low = _mm_set1_epi8('A' - 1);
+    __m128i high = _mm_set1_epi8('E' + 1);
+    for (; cardNum + 16 <= numCards; cardNum += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) &cards[cardNum]);
+        __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(bytes, low),
+                _mm_cmplt_epi8(bytes, high));
+        int mask = _mm_movemask_epi8(ok);
+        if (mask != 0xFFFF) {
+            return cardNum + __builtin_ctz(~mask);
+        }
+    }
+#endif
+    for (; cardNum < numCards; ++cardNum) {
+        if (cards[cardNum] < 'A' || cards[cardNum] > 'E') {
+            return cardNum;
+        }
+    }
+    return -1;
+}
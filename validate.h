@@ -0,0 +1,23 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the number of characters used by each site in a path file, unless a
+// capacity has more than one digit
+#define SITE_WIDTH 3
+
+// the largest capacity a site may be given
+#define MAX_SITE_CAPACITY 999
+
+int first_invalid_site(const char *sites, int numSites);
+int first_invalid_card(const char *cards, int numCards);
+const char *read_wide_site(const char *site, int *capacity);
+
+#endif